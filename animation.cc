@@ -0,0 +1,87 @@
+#include "animation.h"
+
+// The instances per chunk of the pass, as many as the entity integration.
+static const int kAnimateGrain = 16384;
+
+AnimationLibrary::AnimationLibrary() {}
+
+ClipId AnimationLibrary::AddClip(const AnimationFrame* frames, int count, bool loop)
+{
+    if (count <= 0 || clips_.size() >= kNoClip) return kNoClip;
+
+    Clip clip;
+    clip.first  = (int)steps_.size();
+    clip.length = 0.f;
+    for (int i = 0; i < count; ++i) clip.length += SDL_max(frames[i].seconds, 0.f);
+    // A clip of no length can't wrap.
+    clip.loop   = loop && clip.length > 0.f;
+
+    // The frame shown at the start of each step; frames shorter than a step
+    // may never show.
+    int   frame = 0;
+    float end   = SDL_max(frames[0].seconds, 0.f);
+    for (int step = 0; (float)step / kStepsPerSecond < clip.length || step == 0; ++step)
+    {
+        float time = (float)step / kStepsPerSecond;
+        while (frame + 1 < count && time >= end)
+        {
+            ++frame;
+            end += SDL_max(frames[frame].seconds, 0.f);
+        }
+        steps_.push_back(frames[frame].sprite);
+    }
+    clip.count = (int)steps_.size() - clip.first;
+    clips_.push_back(clip);
+
+    return (ClipId)(clips_.size() - 1);
+}
+
+void AnimationLibrary::Clear()
+{
+    clips_.clear();
+    steps_.clear();
+}
+
+float AnimationLibrary::GetLength(ClipId clip)
+{
+    return clip < clips_.size() ? clips_[clip].length : 0.f;
+}
+
+void AnimationLibrary::Animate(const ClipId* clips, float* times, Uint8* sprites, int count,
+                               float seconds, JobSystem* jobs)
+{
+    if (count <= 0 || clips_.empty()) return;
+
+    AnimateJob job;
+    job.library = this;
+    job.clips   = clips;
+    job.times   = times;
+    job.sprites = sprites;
+    job.seconds = seconds;
+
+    if (jobs != NULL) jobs->ParallelFor(count, kAnimateGrain, AnimateRange, &job);
+    else              AnimateRange(&job, 0, count);
+}
+
+void AnimationLibrary::AnimateRange(void* data, int begin, int end)
+{
+    const AnimateJob& job     = *static_cast<AnimateJob*>(data);
+    const Clip*       clips   = &job.library->clips_[0];
+    const Uint8*      steps   = &job.library->steps_[0];
+    int               library = (int)job.library->clips_.size();
+
+    for (int i = begin; i < end; ++i)
+    {
+        ClipId id = job.clips[i];
+        if (id >= library) continue;
+
+        const Clip& clip = clips[id];
+        float       time = job.times[i] + job.seconds;
+        if (time >= clip.length)
+            time = clip.loop ? time - SDL_floorf(time / clip.length) * clip.length : clip.length;
+        job.times[i] = time;
+
+        int step       = (int)(time * kStepsPerSecond);
+        job.sprites[i] = steps[clip.first + SDL_min(step, clip.count - 1)];
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef ANIMATION_H_
+#define ANIMATION_H_
+
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "job_system.h"
+
+// A clip of the library; kNoClip for sprites that don't animate.
+typedef Uint16 ClipId;
+static const ClipId kNoClip = 0xFFFF;
+
+// One frame of a flipbook: which sprite of the sheet, and for how long.
+struct AnimationFrame
+{
+    Uint8 sprite;
+    float seconds;
+};
+
+// The flipbook clips every animated sprite shares. A clip is baked into a
+// table of the sprite shown at each step of kStepsPerSecond when it's added
+// and never changes after, so any number of instances read it while their own
+// state is just a clip id and a time in the entity store's arrays. Animate()
+// advances them all in one linear pass, split across the jobs, and writes the
+// frame's sprite, which picks its rect of the sheet when drawn.
+class AnimationLibrary
+{
+public:
+    // How finely the clips are baked.
+    static const int kStepsPerSecond = 120;
+
+    AnimationLibrary();
+
+    // Add all clips before the first Animate(). Looping clips start over,
+    // the others hold their last frame. kNoClip when there are no frames.
+    ClipId AddClip(const AnimationFrame* frames, int count, bool loop);
+    void   Clear();
+
+    int GetClipCount() { return (int)clips_.size(); }
+    // The clip's length in seconds.
+    float GetLength(ClipId clip);
+
+    // Advance count instances by seconds, wrapping or holding their times,
+    // and set their sprites to the frames shown.
+    void Animate(const ClipId* clips, float* times, Uint8* sprites, int count, float seconds,
+                 JobSystem* jobs);
+
+private:
+    struct Clip
+    {
+        // The clip's steps in the table.
+        int   first;
+        int   count;
+        float length;
+        bool  loop;
+    };
+
+    struct AnimateJob
+    {
+        const AnimationLibrary* library;
+        const ClipId*           clips;
+        float*                  times;
+        Uint8*                  sprites;
+        float                   seconds;
+    };
+
+    static void AnimateRange(void* data, int begin, int end);
+
+    std::vector<Clip>  clips_;
+    // The sprite of every step of every clip.
+    std::vector<Uint8> steps_;
+};
+
+#endif  // ANIMATION_H_
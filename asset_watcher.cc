@@ -0,0 +1,253 @@
+#include "asset_watcher.h"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool ReadAssetFile(const std::string& path, std::vector<char>& bytes)
+{
+    SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+    if (file == NULL) return false;
+
+    Sint64 size = SDL_RWsize(file);
+    if (size < 0)
+    {
+        SDL_RWclose(file);
+        return false;
+    }
+
+    bytes.resize((size_t)size);
+    size_t read = size > 0 ? SDL_RWread(file, &bytes[0], 1, (size_t)size) : 0;
+    SDL_RWclose(file);
+
+    return read == (size_t)size;
+}
+
+static long long GetModifiedTime(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return (long long)st.st_mtime;
+}
+
+AssetWatcher::AssetWatcher() : lock_(SDL_CreateMutex()), thread_(NULL)
+{
+    SDL_AtomicSet(&quit_, 0);
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    Stop();
+    SDL_DestroyMutex(lock_);
+}
+
+void AssetWatcher::Watch(const std::string& path, AssetReloadFunc func, void* userdata)
+{
+    Entry entry;
+    entry.path     = path;
+    entry.func     = func;
+    entry.userdata = userdata;
+    entry.mtime    = GetModifiedTime(path);
+
+    // Split the path into the watched directory and the file name.
+    size_t slash = path.find_last_of("/\\");
+    entry.dir  = slash == std::string::npos ? "." : path.substr(0, slash);
+    entry.name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    entries_.push_back(entry);
+}
+
+bool AssetWatcher::Start()
+{
+    if (thread_ != NULL) return true;
+
+    SDL_AtomicSet(&quit_, 0);
+    thread_ = SDL_CreateThread(ThreadMain, "AssetWatcher", this);
+    return thread_ != NULL;
+}
+
+void AssetWatcher::Stop()
+{
+    if (thread_ == NULL) return;
+
+    SDL_AtomicSet(&quit_, 1);
+    SDL_WaitThread(thread_, NULL);
+    thread_ = NULL;
+}
+
+int AssetWatcher::Poll()
+{
+    // Only the swap of the queue happens under the lock, the watcher thread
+    // has already done the file reads.
+    SDL_LockMutex(lock_);
+    swapping_.swap(pending_);
+    SDL_UnlockMutex(lock_);
+
+    int reloaded = 0;
+    for (size_t i = 0; i < swapping_.size(); ++i)
+    {
+        Entry& entry = entries_[swapping_[i].entry];
+        if (entry.func(entry.userdata, entry.path, swapping_[i].bytes)) ++reloaded;
+    }
+    swapping_.clear();
+
+    return reloaded;
+}
+
+int SDLCALL AssetWatcher::ThreadMain(void* data)
+{
+    static_cast<AssetWatcher*>(data)->Run();
+    return 0;
+}
+
+void AssetWatcher::QueueReload(int entry)
+{
+    Reload reload;
+    reload.entry = entry;
+    if (!ReadAssetFile(entries_[entry].path, reload.bytes)) return;
+
+    SDL_LockMutex(lock_);
+    // An editor may save several times before the next frame, keep the last.
+    bool queued = false;
+    for (size_t i = 0; i < pending_.size(); ++i)
+    {
+        if (pending_[i].entry != entry) continue;
+        pending_[i].bytes.swap(reload.bytes);
+        queued = true;
+    }
+    if (!queued) pending_.push_back(reload);
+    SDL_UnlockMutex(lock_);
+}
+
+#ifdef __linux__
+void AssetWatcher::Run()
+{
+    int fd = inotify_init1(IN_NONBLOCK);
+    if (fd < 0)
+    {
+        RunPolling();
+        return;
+    }
+
+    // One watch per directory, editors usually replace files by renaming.
+    std::vector<int> watches(entries_.size(), -1);
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        watches[i] = inotify_add_watch(fd, entries_[i].dir.c_str(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (SDL_AtomicGet(&quit_) == 0)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        for (char* ptr = buffer; len > 0 && ptr < buffer + len; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            for (size_t i = 0; i < entries_.size(); ++i)
+            {
+                if (watches[i] == event->wd && entries_[i].name == event->name)
+                    QueueReload((int)i);
+            }
+        }
+    }
+
+    close(fd);
+}
+#else
+void AssetWatcher::Run() { RunPolling(); }
+#endif
+
+void AssetWatcher::RunPolling()
+{
+    while (SDL_AtomicGet(&quit_) == 0)
+    {
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            long long mtime = GetModifiedTime(entries_[i].path);
+            if (mtime < 0 || mtime == entries_[i].mtime) continue;
+
+            entries_[i].mtime = mtime;
+            QueueReload((int)i);
+        }
+        SDL_Delay(250);
+    }
+}
+
+FontAsset::FontAsset() : ptsize_(0), font_(NULL) {}
+
+FontAsset::~FontAsset() { Free(); }
+
+bool FontAsset::Load(const std::string& path, int ptsize)
+{
+    path_   = path;
+    ptsize_ = ptsize;
+
+    std::vector<char> bytes;
+    if (!ReadAssetFile(path, bytes)) return false;
+
+    return Reload(this, path, bytes);
+}
+
+void FontAsset::Watch(AssetWatcher& watcher)
+{
+    watcher.Watch(path_, Reload, this);
+}
+
+TTF_Font* FontAsset::Get(int ptsize)
+{
+    if (ptsize == ptsize_ || font_ == NULL) return font_;
+
+    std::map<int, TTF_Font*>::iterator it = sizes_.find(ptsize);
+    if (it != sizes_.end()) return it->second;
+
+    SDL_RWops* rw   = SDL_RWFromConstMem(&bytes_[0], (int)bytes_.size());
+    TTF_Font*  font = TTF_OpenFontRW(rw, 1, ptsize);
+    if (font != NULL) sizes_[ptsize] = font;
+    return font;
+}
+
+void FontAsset::CloseSizes()
+{
+    for (std::map<int, TTF_Font*>::iterator it = sizes_.begin(); it != sizes_.end(); ++it)
+        TTF_CloseFont(it->second);
+    sizes_.clear();
+}
+
+void FontAsset::Free()
+{
+    CloseSizes();
+    if (font_ != NULL) TTF_CloseFont(font_);
+    font_ = NULL;
+    bytes_.clear();
+}
+
+bool FontAsset::Reload(void* userdata, const std::string&, std::vector<char>& bytes)
+{
+    FontAsset* asset = static_cast<FontAsset*>(userdata);
+    if (bytes.empty()) return false;
+
+    // The font reads from the memory for as long as it stays open.
+    SDL_RWops* rw   = SDL_RWFromConstMem(&bytes[0], (int)bytes.size());
+    TTF_Font*  font = TTF_OpenFontRW(rw, 1, asset->ptsize_);
+    // Keep the old font if the new file doesn't parse.
+    if (font == NULL) return false;
+
+    // The other sizes read from the old bytes, they open again on demand.
+    asset->CloseSizes();
+    if (asset->font_ != NULL) TTF_CloseFont(asset->font_);
+    asset->font_ = font;
+    asset->bytes_.swap(bytes);
+
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef ASSET_WATCHER_H_
+#define ASSET_WATCHER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_ttf.h"
+
+// Called at the frame boundary with the freshly read contents of a changed
+// file. The callee may swap the bytes out to keep them alive.
+typedef bool (*AssetReloadFunc)(void* userdata, const std::string& path,
+                                std::vector<char>& bytes);
+
+// Reads a whole file into memory.
+bool ReadAssetFile(const std::string& path, std::vector<char>& bytes);
+
+// The development hot-reload service. A background thread watches the
+// directories of the registered files (inotify on Linux, modification time
+// polling elsewhere), reads changed files off the render thread and queues
+// them until the next Poll().
+class AssetWatcher
+{
+public:
+    AssetWatcher();
+    ~AssetWatcher();
+
+    // Register a file before Start().
+    void Watch(const std::string& path, AssetReloadFunc func, void* userdata);
+
+    // Start and stop the watcher thread.
+    bool Start();
+    void Stop();
+
+    // Swap in every reloaded asset. Call once per frame at the frame
+    // boundary; returns the number of assets reloaded.
+    int Poll();
+
+private:
+    struct Entry
+    {
+        std::string     path;
+        std::string     dir;
+        std::string     name;
+        AssetReloadFunc func;
+        void*           userdata;
+        long long       mtime;
+    };
+
+    struct Reload
+    {
+        int               entry;
+        std::vector<char> bytes;
+    };
+
+    static int SDLCALL ThreadMain(void* data);
+    void Run();
+    void RunPolling();
+    void QueueReload(int entry);
+
+    std::vector<Entry>  entries_;
+
+    // The reloads waiting for the next frame boundary.
+    std::vector<Reload> pending_;
+    std::vector<Reload> swapping_;
+    SDL_mutex*          lock_;
+
+    SDL_Thread*         thread_;
+    SDL_atomic_t        quit_;
+};
+
+// A font that the hot-reload service can swap in place. The font is opened
+// from an in-memory copy of the file, so a reload never blocks on disk.
+class FontAsset
+{
+public:
+    FontAsset();
+    ~FontAsset();
+
+    bool Load(const std::string& path, int ptsize);
+    void Watch(AssetWatcher& watcher);
+    void Free();
+
+    TTF_Font* Get() { return font_; }
+    // The font at another point size, opened from the same bytes on first
+    // use. Not thread-safe, like the rest of SDL_ttf.
+    TTF_Font* Get(int ptsize);
+    int GetSize() { return ptsize_; }
+
+private:
+    static bool Reload(void* userdata, const std::string& path, std::vector<char>& bytes);
+    void CloseSizes();
+
+    std::string       path_;
+    int               ptsize_;
+    TTF_Font*         font_;
+    std::vector<char> bytes_;
+    // The fonts at the other sizes.
+    std::map<int, TTF_Font*> sizes_;
+};
+
+#endif  // ASSET_WATCHER_H_
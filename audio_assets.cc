@@ -0,0 +1,422 @@
+#include "audio_assets.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "SDL2/SDL_mixer.h"
+
+#include "logger.h"
+#include "mixer.h"
+
+SoundCache::SoundCache() : jobs_(NULL), budget_(0), resident_(0), tick_(0), lock_(NULL) {}
+
+SoundCache::~SoundCache() { Free(); }
+
+bool SoundCache::Init(JobSystem* jobs, int budgetBytes)
+{
+    jobs_   = jobs;
+    budget_ = budgetBytes;
+    lock_   = SDL_CreateMutex();
+    return lock_ != NULL;
+}
+
+void SoundCache::Free()
+{
+    if (jobs_ != NULL) jobs_->Wait(&decodeJobs_);
+
+    if (lock_ != NULL)
+    {
+        for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+            FreeClip(it->second.clip);
+        SDL_DestroyMutex(lock_);
+    }
+
+    entries_.clear();
+    resident_ = 0;
+    lock_     = NULL;
+    jobs_     = NULL;
+}
+
+const AudioClip* SoundCache::Get(const std::string& path)
+{
+    if (lock_ == NULL) return NULL;
+
+    SDL_LockMutex(lock_);
+    // Only here, so a clip stays put between Get() and Play().
+    Evict();
+
+    const AudioClip*   clip = NULL;
+    EntryMap::iterator it   = entries_.find(path);
+    if (it != entries_.end())
+    {
+        it->second.lastUse = ++tick_;
+        clip               = it->second.clip;
+    }
+    else
+    {
+        Entry entry    = {NULL, true, 0, ++tick_};
+        entries_[path] = entry;
+
+        DecodeJob* job = new DecodeJob;
+        job->cache     = this;
+        job->path      = path;
+        jobs_->Schedule(RunDecodeJob, job, &decodeJobs_);
+    }
+    SDL_UnlockMutex(lock_);
+
+    return clip;
+}
+
+int SoundCache::GetResidentBytes()
+{
+    if (lock_ == NULL) return 0;
+
+    SDL_LockMutex(lock_);
+    int resident = resident_;
+    SDL_UnlockMutex(lock_);
+    return resident;
+}
+
+void SoundCache::RunDecodeJob(void* data)
+{
+    DecodeJob*  job   = static_cast<DecodeJob*>(data);
+    SoundCache* cache = job->cache;
+
+    int        bytes = 0;
+    AudioClip* clip  = Decode(job->path, bytes);
+    if (clip == NULL) LogError("Load sound Error: {}: {}", job->path, Mix_GetError());
+
+    // Decoding entries are never evicted. A failed sound keeps its empty
+    // entry so it isn't decoded again every time it's asked for.
+    SDL_LockMutex(cache->lock_);
+    Entry& entry      = cache->entries_[job->path];
+    entry.clip        = clip;
+    entry.bytes       = bytes;
+    entry.decoding    = false;
+    cache->resident_ += bytes;
+    SDL_UnlockMutex(cache->lock_);
+
+    delete job;
+}
+
+AudioClip* SoundCache::Decode(const std::string& path, int& bytes)
+{
+    // SDL_mixer converts to the device's format as it loads.
+    Mix_Chunk* chunk = Mix_LoadWAV(path.c_str());
+    if (chunk == NULL) return NULL;
+
+    Sint16* samples = (Sint16*)SDL_SIMDAlloc(chunk->alen);
+    if (samples == NULL)
+    {
+        Mix_FreeChunk(chunk);
+        return NULL;
+    }
+    SDL_memcpy(samples, chunk->abuf, chunk->alen);
+
+    AudioClip* clip = new AudioClip;
+    clip->samples   = samples;
+    clip->frames    = (int)(chunk->alen / (2 * sizeof(Sint16)));
+    SDL_AtomicSet(&clip->users, 0);
+    bytes = (int)chunk->alen;
+
+    Mix_FreeChunk(chunk);
+    return clip;
+}
+
+void SoundCache::FreeClip(AudioClip* clip)
+{
+    if (clip == NULL) return;
+
+    SDL_SIMDFree((void*)clip->samples);
+    delete clip;
+}
+
+bool SoundCache::UsedEarlier(EntryMap::iterator a, EntryMap::iterator b)
+{
+    return a->second.lastUse < b->second.lastUse;
+}
+
+void SoundCache::Evict()
+{
+    if (resident_ <= budget_) return;
+
+    // The sounds no voice is playing or queued to play.
+    std::vector<EntryMap::iterator> idle;
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        AudioClip* clip = it->second.clip;
+        if (clip != NULL && SDL_AtomicGet(&clip->users) == 0) idle.push_back(it);
+    }
+    std::sort(idle.begin(), idle.end(), UsedEarlier);
+
+    for (size_t i = 0; i < idle.size() && resident_ > budget_; ++i)
+    {
+        resident_ -= idle[i]->second.bytes;
+        FreeClip(idle[i]->second.clip);
+        entries_.erase(idle[i]);
+    }
+}
+
+MusicStream::MusicStream()
+    : file_(NULL), dataStart_(0), dataEnd_(0), format_(0), channels_(0), rate_(0), loop_(false),
+      converter_(NULL), playing_(0), position_(0), started_(false), mix_(NULL), thread_(NULL),
+      free_(NULL)
+{
+    buffers_[0] = buffers_[1] = NULL;
+    frames_[0] = frames_[1] = 0;
+    SDL_AtomicSet(&ready_[0], 0);
+    SDL_AtomicSet(&ready_[1], 0);
+    SDL_AtomicSet(&finished_, 0);
+    SDL_AtomicSet(&quit_, 0);
+    SDL_AtomicSet(&volume_, 256);
+    SDL_AtomicSet(&underruns_, 0);
+}
+
+MusicStream::~MusicStream() { Stop(); }
+
+bool MusicStream::Play(const std::string& path, bool loop)
+{
+    Stop();
+
+    int    frequency;
+    Uint16 format;
+    int    channels;
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0) return false;
+
+    file_ = SDL_RWFromFile(path.c_str(), "rb");
+    if (file_ == NULL || !ReadHeader())
+    {
+        Stop();
+        return false;
+    }
+
+    // Whatever the file holds comes out like the voices: stereo S16.
+    loop_       = loop;
+    converter_  = SDL_NewAudioStream(format_, (Uint8)channels_, rate_, AUDIO_S16SYS, 2, frequency);
+    buffers_[0] = (Sint16*)SDL_SIMDAlloc(kBufferFrames * 2 * sizeof(Sint16));
+    buffers_[1] = (Sint16*)SDL_SIMDAlloc(kBufferFrames * 2 * sizeof(Sint16));
+    mix_        = (float*)SDL_SIMDAlloc(kBufferFrames * 2 * sizeof(float));
+    free_       = SDL_CreateSemaphore(2);
+    if (converter_ == NULL || buffers_[0] == NULL || buffers_[1] == NULL || mix_ == NULL ||
+        free_ == NULL)
+    {
+        Stop();
+        return false;
+    }
+
+    playing_  = 0;
+    position_ = 0;
+    started_  = false;
+    SDL_AtomicSet(&ready_[0], 0);
+    SDL_AtomicSet(&ready_[1], 0);
+    SDL_AtomicSet(&finished_, 0);
+    SDL_AtomicSet(&quit_, 0);
+
+    thread_ = SDL_CreateThread(DecoderMain, "Music", this);
+    if (thread_ == NULL)
+    {
+        Stop();
+        return false;
+    }
+
+    Mix_HookMusic(Hook, this);
+    return true;
+}
+
+void MusicStream::Stop()
+{
+    // Waits for a running hook.
+    if (thread_ != NULL) Mix_HookMusic(NULL, NULL);
+
+    if (thread_ != NULL)
+    {
+        SDL_AtomicSet(&quit_, 1);
+        SDL_SemPost(free_);
+        SDL_WaitThread(thread_, NULL);
+    }
+
+    if (converter_ != NULL) SDL_FreeAudioStream(converter_);
+    if (file_ != NULL) SDL_RWclose(file_);
+    if (free_ != NULL) SDL_DestroySemaphore(free_);
+    SDL_SIMDFree(buffers_[0]);
+    SDL_SIMDFree(buffers_[1]);
+    SDL_SIMDFree(mix_);
+
+    thread_     = NULL;
+    converter_  = NULL;
+    file_       = NULL;
+    free_       = NULL;
+    buffers_[0] = buffers_[1] = NULL;
+    mix_        = NULL;
+}
+
+int SDLCALL MusicStream::DecoderMain(void* data)
+{
+    MusicStream* music = static_cast<MusicStream*>(data);
+
+    int next = 0;
+    while (SDL_AtomicGet(&music->quit_) == 0)
+    {
+        if (SDL_SemWaitTimeout(music->free_, 100) != 0) continue;
+        if (SDL_AtomicGet(&music->quit_) != 0) break;
+
+        // Hand the buffer over only once it's full.
+        bool more = music->Fill(next);
+        if (music->frames_[next] > 0)
+        {
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&music->ready_[next], 1);
+        }
+        next ^= 1;
+
+        if (!more)
+        {
+            SDL_AtomicSet(&music->finished_, 1);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+void SDLCALL MusicStream::Hook(void* udata, Uint8* stream, int len)
+{
+    static_cast<MusicStream*>(udata)->Output((Sint16*)stream, len / (int)(2 * sizeof(Sint16)));
+}
+
+bool MusicStream::ReadHeader()
+{
+    Uint8 riff[12];
+    if (SDL_RWread(file_, riff, 1, sizeof(riff)) != sizeof(riff) ||
+        SDL_memcmp(riff, "RIFF", 4) != 0 || SDL_memcmp(riff + 8, "WAVE", 4) != 0)
+    {
+        SDL_SetError("Not a WAV file");
+        return false;
+    }
+
+    bool haveFormat = false;
+    for (;;)
+    {
+        Uint8 id[4];
+        if (SDL_RWread(file_, id, 1, sizeof(id)) != sizeof(id))
+        {
+            SDL_SetError("No WAV data");
+            return false;
+        }
+        Uint32 size = SDL_ReadLE32(file_);
+
+        if (SDL_memcmp(id, "fmt ", 4) == 0 && size >= 16)
+        {
+            Uint16 tag = SDL_ReadLE16(file_);
+            channels_  = SDL_ReadLE16(file_);
+            rate_      = (int)SDL_ReadLE32(file_);
+            SDL_ReadLE32(file_);
+            SDL_ReadLE16(file_);
+            Uint16 bits = SDL_ReadLE16(file_);
+
+            // PCM and float; anything compressed goes through SoundCache.
+            if (tag == 1 && bits == 8)        format_ = AUDIO_U8;
+            else if (tag == 1 && bits == 16)  format_ = AUDIO_S16LSB;
+            else if (tag == 1 && bits == 32)  format_ = AUDIO_S32LSB;
+            else if (tag == 3 && bits == 32)  format_ = AUDIO_F32LSB;
+            else
+            {
+                SDL_SetError("Unsupported WAV format");
+                return false;
+            }
+            if (channels_ < 1 || channels_ > 8 || rate_ <= 0)
+            {
+                SDL_SetError("Bad WAV format");
+                return false;
+            }
+
+            haveFormat = true;
+            size      -= 16;
+        }
+        else if (SDL_memcmp(id, "data", 4) == 0)
+        {
+            if (!haveFormat)
+            {
+                SDL_SetError("WAV data before its format");
+                return false;
+            }
+            dataStart_ = SDL_RWtell(file_);
+            dataEnd_   = dataStart_ + size;
+            return true;
+        }
+
+        // Chunks are padded to an even size.
+        SDL_RWseek(file_, size + (size & 1), RW_SEEK_CUR);
+    }
+}
+
+bool MusicStream::Fill(int buffer)
+{
+    const int want      = kBufferFrames * 2 * sizeof(Sint16);
+    const int frameSize = channels_ * SDL_AUDIO_BITSIZE(format_) / 8;
+    Uint8     block[4096];
+
+    bool more = true;
+    while (more && SDL_AudioStreamAvailable(converter_) < want)
+    {
+        // The converter only takes whole frames.
+        Sint64 left  = SDL_max(dataEnd_ - SDL_RWtell(file_), (Sint64)0);
+        size_t count = (size_t)SDL_min(left, (Sint64)sizeof(block)) / frameSize * frameSize;
+        size_t read  = count > 0 ? SDL_RWread(file_, block, 1, count) : 0;
+        if (read >= (size_t)frameSize)
+        {
+            SDL_AudioStreamPut(converter_, block, (int)(read / frameSize * frameSize));
+            continue;
+        }
+
+        if (loop_ && SDL_RWtell(file_) > dataStart_)
+        {
+            SDL_RWseek(file_, dataStart_, RW_SEEK_SET);
+            continue;
+        }
+
+        // Out comes what the converter held back.
+        SDL_AudioStreamFlush(converter_);
+        more = false;
+    }
+
+    int got         = SDL_AudioStreamGet(converter_, buffers_[buffer], want);
+    frames_[buffer] = got > 0 ? got / (int)(2 * sizeof(Sint16)) : 0;
+
+    // The track ends with the last of what was flushed.
+    return more || SDL_AudioStreamAvailable(converter_) > 0;
+}
+
+void MusicStream::Output(Sint16* stream, int frames)
+{
+    float gain = SDL_AtomicGet(&volume_) / 256.f;
+
+    int done = 0;
+    while (done < frames)
+    {
+        if (SDL_AtomicGet(&ready_[playing_]) == 0)
+        {
+            // Silence before the first buffer and after the last is expected.
+            if (started_ && SDL_AtomicGet(&finished_) == 0) SDL_AtomicAdd(&underruns_, 1);
+            return;
+        }
+        SDL_MemoryBarrierAcquire();
+        started_ = true;
+
+        // The stream is silence already; add the music in like a voice.
+        int count = SDL_min(frames - done, frames_[playing_] - position_);
+        SDL_memset(mix_, 0, count * 2 * sizeof(float));
+        MixSamples(mix_, buffers_[playing_] + 2 * position_, count, gain, gain, 0.f, 0.f);
+        WriteSamples(stream + 2 * done, mix_, count * 2);
+        done      += count;
+        position_ += count;
+
+        if (position_ == frames_[playing_])
+        {
+            SDL_AtomicSet(&ready_[playing_], 0);
+            SDL_SemPost(free_);
+            playing_  = playing_ ^ 1;
+            position_ = 0;
+        }
+    }
+}
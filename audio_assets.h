@@ -0,0 +1,133 @@
+#ifndef AUDIO_ASSETS_H_
+#define AUDIO_ASSETS_H_
+
+#include <map>
+#include <string>
+
+#include "SDL2/SDL.h"
+
+#include "audio_engine.h"
+#include "job_system.h"
+
+// The decoded sound effects, shared by everything that plays them. A sound
+// is decoded on the jobs the first time it's asked for, into the device's
+// format in SIMD-aligned memory; until then it plays as silence. The least
+// recently used sounds nobody plays get evicted to stay within a memory
+// budget. Only used by the game thread.
+class SoundCache
+{
+public:
+    SoundCache();
+    ~SoundCache();
+
+    // Open the audio engine first, the sounds decode to its format.
+    bool Init(JobSystem* jobs, int budgetBytes);
+    // Waits for the decodes; call after the audio engine closed.
+    void Free();
+
+    // The sound, or NULL while it's being decoded or failed to. Good until
+    // the next Get(); playing it keeps it from being evicted.
+    const AudioClip* Get(const std::string& path);
+    // Start decoding ahead of the first Get().
+    void Preload(const std::string& path) { Get(path); }
+
+    // The bytes of decoded samples held.
+    int GetResidentBytes();
+
+private:
+    struct Entry
+    {
+        // NULL while decoding, and after a failed decode.
+        AudioClip* clip;
+        bool       decoding;
+        int        bytes;
+        unsigned   lastUse;
+    };
+
+    struct DecodeJob
+    {
+        SoundCache* cache;
+        std::string path;
+    };
+
+    typedef std::map<std::string, Entry> EntryMap;
+
+    static void RunDecodeJob(void* data);
+    static AudioClip* Decode(const std::string& path, int& bytes);
+    static void FreeClip(AudioClip* clip);
+    static bool UsedEarlier(EntryMap::iterator a, EntryMap::iterator b);
+    // Drop the least recently used idle sounds until within the budget.
+    // Under the lock.
+    void Evict();
+
+    EntryMap    entries_;
+    JobSystem*  jobs_;
+    int         budget_;
+    int         resident_;
+    unsigned    tick_;
+    // The decode jobs fill in the entries.
+    SDL_mutex*  lock_;
+    JobCounter  decodeJobs_;
+};
+
+// A long track streamed from disk: a decoder thread converts the file to the
+// device's format a buffer ahead, and SDL_mixer's music hook plays the other
+// buffer. The hook never waits for the decoder; it plays silence and counts
+// an underrun when the next buffer isn't ready. Streams uncompressed WAV.
+class MusicStream
+{
+public:
+    // The frames per buffer, about 170 ms at 48 kHz.
+    static const int kBufferFrames = 8192;
+
+    MusicStream();
+    ~MusicStream();
+
+    // Stop the current track and stream another. Open the audio engine first.
+    bool Play(const std::string& path, bool loop);
+    void Stop();
+
+    // 0 to 1.
+    void SetVolume(float volume) { SDL_AtomicSet(&volume_, (int)(volume * 256)); }
+
+    // The times the hook found the next buffer still decoding.
+    int GetUnderruns() { return SDL_AtomicGet(&underruns_); }
+
+private:
+    static int SDLCALL DecoderMain(void* data);
+    static void SDLCALL Hook(void* udata, Uint8* stream, int len);
+    bool ReadHeader();
+    // Decode the next buffer; false at the end of a track that doesn't loop.
+    bool Fill(int buffer);
+    // The hook's side.
+    void Output(Sint16* stream, int frames);
+
+    SDL_RWops*       file_;
+    Sint64           dataStart_;
+    Sint64           dataEnd_;
+    SDL_AudioFormat  format_;
+    int              channels_;
+    int              rate_;
+    bool             loop_;
+    SDL_AudioStream* converter_;
+
+    // The two buffers, each ready or free for the decoder. Only the hook
+    // touches playing_ and position_.
+    Sint16*          buffers_[2];
+    int              frames_[2];
+    SDL_atomic_t     ready_[2];
+    int              playing_;
+    int              position_;
+    bool             started_;
+    float*           mix_;
+
+    SDL_Thread*      thread_;
+    // Posted whenever the hook frees a buffer.
+    SDL_sem*         free_;
+    SDL_atomic_t     finished_;
+    SDL_atomic_t     quit_;
+    SDL_atomic_t     volume_;
+    SDL_atomic_t     underruns_;
+};
+
+#endif  // AUDIO_ASSETS_H_
@@ -0,0 +1,77 @@
+#include "audio_bench.h"
+
+#include "logger.h"
+#include "mixer.h"
+
+AudioBench::AudioBench() : maxVoices_(0), underruns_(0)
+{
+    noise_.samples = NULL;
+    noise_.frames  = 0;
+    SDL_AtomicSet(&noise_.users, 0);
+}
+
+AudioBench::~AudioBench() { SDL_SIMDFree((void*)noise_.samples); }
+
+bool AudioBench::Run(AudioEngine* audio, double budget, int holdMs)
+{
+    if (!audio->IsOpen()) return false;
+
+    // A second of noise, so the voices don't all line up on the same samples.
+    int    frequency;
+    Uint16 format;
+    int    channels;
+    Mix_QuerySpec(&frequency, &format, &channels);
+    if (noise_.samples == NULL && !CreateNoise(frequency)) return false;
+
+    maxVoices_ = 0;
+    underruns_ = 0;
+    bool fits  = true;
+    for (int voices = kVoiceStep; voices <= AudioEngine::kMaxVoices; voices += kVoiceStep)
+    {
+        // Spread across the stereo field, quiet enough not to clip.
+        for (int i = voices - kVoiceStep; i < voices; ++i)
+            audio->Play(&noise_, 1.f / AudioEngine::kMaxVoices,
+                        i * 2.f / AudioEngine::kMaxVoices - 1.f, true);
+
+        // Let the voices start before measuring.
+        SDL_Delay(50);
+        audio->ResetCallbackStats();
+        SDL_Delay(holdMs);
+
+        AudioCallbackStats stats;
+        audio->GetCallbackStats(stats);
+        underruns_ += stats.underruns;
+        fits        = fits && stats.maxLoad <= budget && stats.underruns == 0;
+        if (fits) maxVoices_ = voices;
+
+        LogInfo("Audio bench: {} voices, {} callbacks, load {}% mean, {}% max, {} underruns",
+                audio->GetActiveVoices(), stats.callbacks, stats.meanLoad * 100,
+                stats.maxLoad * 100, stats.underruns);
+    }
+
+    // The voices hold on to the noise until they've faded out.
+    audio->StopAll();
+    for (int wait = 0; wait < 100 && SDL_AtomicGet(&noise_.users) != 0; ++wait) SDL_Delay(10);
+
+    LogInfo("Audio bench: {} voices within {}% of the buffer time, {} underruns, mixed with {}",
+            maxVoices_, budget * 100, underruns_, GetMixSamplesName());
+    return true;
+}
+
+bool AudioBench::CreateNoise(int frames)
+{
+    Sint16* samples = (Sint16*)SDL_SIMDAlloc(frames * 2 * sizeof(Sint16));
+    if (samples == NULL) return false;
+
+    // A fixed seed keeps the runs comparable.
+    Uint32 seed = 12345;
+    for (int i = 0; i < frames * 2; ++i)
+    {
+        seed       = seed * 1664525 + 1013904223;
+        samples[i] = (Sint16)(seed >> 16);
+    }
+
+    noise_.samples = samples;
+    noise_.frames  = frames;
+    return true;
+}
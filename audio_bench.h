@@ -0,0 +1,37 @@
+#ifndef AUDIO_BENCH_H_
+#define AUDIO_BENCH_H_
+
+#include "SDL2/SDL.h"
+
+#include "audio_engine.h"
+
+// Measures what mixing costs as the voices add up. Plays looping noise on an
+// open engine, adding a step of voices at a time and holding each count for
+// a while, and reports the callback's load at every step. With no sound card
+// it runs against the dummy or disk driver, which pace the callback like one.
+class AudioBench
+{
+public:
+    // The voices added per step, up to AudioEngine::kMaxVoices.
+    static const int kVoiceStep = 8;
+
+    AudioBench();
+    ~AudioBench();
+
+    // A step fits the budget when no callback took more than budget of its
+    // buffer's time and none ran late. False without an open engine.
+    bool Run(AudioEngine* audio, double budget, int holdMs);
+
+    // The most voices that fit the budget, and the underruns over all steps.
+    int GetMaxVoices() { return maxVoices_; }
+    int GetUnderruns() { return underruns_; }
+
+private:
+    bool CreateNoise(int frames);
+
+    AudioClip noise_;
+    int       maxVoices_;
+    int       underruns_;
+};
+
+#endif  // AUDIO_BENCH_H_
@@ -0,0 +1,375 @@
+#include "audio_engine.h"
+
+#include "mixer.h"
+
+AudioCommandQueue::AudioCommandQueue()
+{
+    SDL_AtomicSet(&head_, 0);
+    SDL_AtomicSet(&tail_, 0);
+}
+
+bool AudioCommandQueue::Push(const AudioCommand& command)
+{
+    int head = SDL_AtomicGet(&head_);
+    if (head - SDL_AtomicGet(&tail_) == kCapacity) return false;
+
+    // Publish the command before the index that hands it over.
+    commands_[head & (kCapacity - 1)] = command;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&head_, head + 1);
+    return true;
+}
+
+bool AudioCommandQueue::Pop(AudioCommand& command)
+{
+    int tail = SDL_AtomicGet(&tail_);
+    if (tail == SDL_AtomicGet(&head_)) return false;
+
+    SDL_MemoryBarrierAcquire();
+    command = commands_[tail & (kCapacity - 1)];
+    SDL_AtomicSet(&tail_, tail + 1);
+    return true;
+}
+
+AudioEngine::AudioEngine()
+    : open_(false), nextVoice_(0), mix_(NULL), lastCallback_(0), frequency_(0),
+      callbackTimeMetric_(NULL), voicesMetric_(NULL), droppedVoicesMetric_(NULL)
+{
+    SDL_zero(voices_);
+    SDL_AtomicSet(&activeVoices_, 0);
+    SDL_AtomicSet(&droppedCommands_, 0);
+    SDL_AtomicSet(&droppedVoices_, 0);
+    SDL_AtomicSet(&callbacks_, 0);
+    SDL_AtomicSet(&mixTime_, 0);
+    SDL_AtomicSet(&bufferTime_, 0);
+    SDL_AtomicSet(&maxLoad_, 0);
+    SDL_AtomicSet(&underruns_, 0);
+    SDL_AtomicSet(&resetStats_, 0);
+}
+
+AudioEngine::~AudioEngine() { Close(); }
+
+bool AudioEngine::Open(int frequency, int bufferFrames)
+{
+    if (Mix_OpenAudio(frequency, MIX_DEFAULT_FORMAT, 2, bufferFrames) != 0) return false;
+
+    // The voices are mixed as stereo S16, which SDL_mixer may not get.
+    Uint16 format;
+    int    channels;
+    Mix_QuerySpec(&frequency, &format, &channels);
+    if (format != AUDIO_S16SYS || channels != 2)
+    {
+        Mix_CloseAudio();
+        SDL_SetError("Unsupported audio format");
+        return false;
+    }
+
+    mix_ = (float*)SDL_SIMDAlloc(kMixFrames * 2 * sizeof(float));
+    if (mix_ == NULL)
+    {
+        Mix_CloseAudio();
+        return false;
+    }
+
+    // Our voices take the place of SDL_mixer's channels.
+    frequency_    = frequency;
+    lastCallback_ = 0;
+    Mix_AllocateChannels(0);
+    Mix_SetPostMix(PostMix, this);
+    open_ = true;
+
+    return true;
+}
+
+void AudioEngine::Close()
+{
+    if (!open_) return;
+
+    // Waits for a running callback.
+    Mix_SetPostMix(NULL, NULL);
+    Mix_CloseAudio();
+
+    // Let go of the clips still queued or playing.
+    AudioCommand command;
+    while (commands_.Pop(command))
+        if (command.type == AudioCommand::kPlay) SDL_AtomicAdd(&command.clip->users, -1);
+    for (int i = 0; i < kMaxVoices; ++i)
+        if (voices_[i].id != 0) EndVoice(voices_[i]);
+
+    SDL_SIMDFree(mix_);
+    mix_  = NULL;
+    open_ = false;
+}
+
+Uint32 AudioEngine::Play(const AudioClip* clip, float volume, float pan, bool loop)
+{
+    if (!open_ || clip == NULL) return 0;
+
+    // Never hand out 0.
+    if (++nextVoice_ == 0) ++nextVoice_;
+
+    AudioCommand command;
+    command.type   = AudioCommand::kPlay;
+    command.voice  = nextVoice_;
+    command.clip   = clip;
+    command.volume = volume;
+    command.pan    = pan;
+    command.loop   = loop;
+
+    // The clip stays alive from here until its voice ends.
+    SDL_AtomicIncRef(&clip->users);
+    if (!commands_.Push(command))
+    {
+        SDL_AtomicAdd(&clip->users, -1);
+        SDL_AtomicAdd(&droppedCommands_, 1);
+        return 0;
+    }
+
+    return nextVoice_;
+}
+
+void AudioEngine::Stop(Uint32 voice)
+{
+    if (voice == 0) return;
+
+    AudioCommand command = {AudioCommand::kStop, voice, NULL, 0.f, 0.f, false};
+    Post(command);
+}
+
+void AudioEngine::SetVolume(Uint32 voice, float volume, float pan)
+{
+    if (voice == 0) return;
+
+    AudioCommand command = {AudioCommand::kSetVolume, voice, NULL, volume, pan, false};
+    Post(command);
+}
+
+void AudioEngine::StopAll()
+{
+    AudioCommand command = {AudioCommand::kStopAll, 0, NULL, 0.f, 0.f, false};
+    Post(command);
+}
+
+void AudioEngine::SetMetrics(Metrics* metrics)
+{
+    callbackTimeMetric_  = metrics->AddHistogram("audio_callback_us",
+                                                 "Time to mix a buffer in microseconds.");
+    voicesMetric_        = metrics->AddGauge("audio_voices", "Voices playing.");
+    droppedVoicesMetric_ = metrics->AddCounter("audio_dropped_voices_total",
+                                               "Sounds dropped for lack of a voice.");
+}
+
+void AudioEngine::GetCallbackStats(AudioCallbackStats& stats)
+{
+    int    mixTime    = SDL_AtomicGet(&mixTime_);
+    int    bufferTime = SDL_AtomicGet(&bufferTime_);
+    stats.callbacks   = SDL_AtomicGet(&callbacks_);
+    stats.meanLoad    = bufferTime > 0 ? (double)mixTime / bufferTime : 0.0;
+    stats.maxLoad     = SDL_AtomicGet(&maxLoad_) / 10000.0;
+    stats.underruns   = SDL_AtomicGet(&underruns_);
+}
+
+void AudioEngine::Post(const AudioCommand& command)
+{
+    if (open_ && !commands_.Push(command)) SDL_AtomicAdd(&droppedCommands_, 1);
+}
+
+void SDLCALL AudioEngine::PostMix(void* udata, Uint8* stream, int len)
+{
+    static_cast<AudioEngine*>(udata)->Mix((Sint16*)stream, len / (int)(2 * sizeof(Sint16)));
+}
+
+void AudioEngine::Mix(Sint16* stream, int frames)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    AudioCommand command;
+    while (commands_.Pop(command)) Apply(command);
+
+    int active = 0;
+    for (int done = 0; done < frames; done += kMixFrames)
+    {
+        int count = SDL_min(kMixFrames, frames - done);
+        SDL_memset(mix_, 0, count * 2 * sizeof(float));
+
+        active = 0;
+        for (int i = 0; i < kMaxVoices; ++i)
+        {
+            if (voices_[i].id == 0) continue;
+            MixVoice(voices_[i], count);
+            ++active;
+        }
+
+        // On top of SDL_mixer's music.
+        WriteSamples(stream + 2 * done, mix_, count * 2);
+    }
+    SDL_AtomicSet(&activeVoices_, active);
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint32 elapsed   = (Uint32)((SDL_GetPerformanceCounter() - start) * 1000000 / frequency);
+    if (callbackTimeMetric_ != NULL)
+    {
+        callbackTimeMetric_->Record(elapsed);
+        voicesMetric_->Set(active);
+    }
+
+    // The time the buffer lasts, and since the last callback.
+    Uint32 buffer = (Uint32)((Uint64)frames * 1000000 / frequency_);
+    Uint32 gap    = lastCallback_ != 0 ? (Uint32)((start - lastCallback_) * 1000000 / frequency)
+                                       : 0;
+    lastCallback_ = start;
+    if (SDL_AtomicGet(&resetStats_) != 0)
+    {
+        SDL_AtomicSet(&callbacks_, 0);
+        SDL_AtomicSet(&mixTime_, 0);
+        SDL_AtomicSet(&bufferTime_, 0);
+        SDL_AtomicSet(&maxLoad_, 0);
+        SDL_AtomicSet(&underruns_, 0);
+        SDL_AtomicSet(&resetStats_, 0);
+        gap = 0;
+    }
+
+    // The load in hundredths of a percent.
+    int load = buffer > 0 ? (int)((Uint64)elapsed * 10000 / buffer) : 0;
+    SDL_AtomicAdd(&callbacks_, 1);
+    SDL_AtomicAdd(&mixTime_, (int)elapsed);
+    SDL_AtomicAdd(&bufferTime_, (int)buffer);
+    if (load > SDL_AtomicGet(&maxLoad_)) SDL_AtomicSet(&maxLoad_, load);
+    if (elapsed > buffer || gap > 2 * buffer) SDL_AtomicAdd(&underruns_, 1);
+}
+
+void AudioEngine::Apply(const AudioCommand& command)
+{
+    switch (command.type)
+    {
+    case AudioCommand::kPlay:
+    {
+        Voice* voice = FindVoice(0);
+        if (voice == NULL)
+        {
+            SDL_AtomicAdd(&command.clip->users, -1);
+            SDL_AtomicAdd(&droppedVoices_, 1);
+            if (droppedVoicesMetric_ != NULL) droppedVoicesMetric_->Add();
+            break;
+        }
+
+        // Fade in from silence.
+        voice->id       = command.voice;
+        voice->clip     = command.clip;
+        voice->position = 0;
+        voice->loop     = command.loop;
+        voice->stopping = false;
+        voice->left     = 0.f;
+        voice->right    = 0.f;
+        voice->ramp     = kRampFrames;
+        GetGains(command.volume, command.pan, voice->targetLeft, voice->targetRight);
+        break;
+    }
+
+    case AudioCommand::kStop:
+    case AudioCommand::kStopAll:
+        for (int i = 0; i < kMaxVoices; ++i)
+        {
+            Voice& voice = voices_[i];
+            if (voice.id == 0) continue;
+            if (command.type == AudioCommand::kStop && voice.id != command.voice) continue;
+
+            // Fade out, then free the voice.
+            voice.stopping    = true;
+            voice.targetLeft  = 0.f;
+            voice.targetRight = 0.f;
+            voice.ramp        = kRampFrames;
+        }
+        break;
+
+    case AudioCommand::kSetVolume:
+    {
+        Voice* voice = FindVoice(command.voice);
+        if (voice == NULL || voice->stopping) break;
+
+        GetGains(command.volume, command.pan, voice->targetLeft, voice->targetRight);
+        voice->ramp = kRampFrames;
+        break;
+    }
+    }
+}
+
+void AudioEngine::MixVoice(Voice& voice, int frames)
+{
+    const AudioClip* clip = voice.clip;
+    if (clip->frames <= 0)
+    {
+        EndVoice(voice);
+        return;
+    }
+
+    int done = 0;
+    while (done < frames)
+    {
+        // Up to the end of the pass, of the clip, or of the ramp.
+        int   count     = SDL_min(frames - done, clip->frames - voice.position);
+        float leftStep  = 0.f;
+        float rightStep = 0.f;
+        if (voice.ramp > 0)
+        {
+            count     = SDL_min(count, voice.ramp);
+            leftStep  = (voice.targetLeft - voice.left) / voice.ramp;
+            rightStep = (voice.targetRight - voice.right) / voice.ramp;
+        }
+
+        MixSamples(mix_ + 2 * done, clip->samples + 2 * voice.position, count, voice.left,
+                   voice.right, leftStep, rightStep);
+        done           += count;
+        voice.position += count;
+
+        if (voice.ramp > 0)
+        {
+            voice.ramp  -= count;
+            voice.left  += leftStep * count;
+            voice.right += rightStep * count;
+            if (voice.ramp == 0)
+            {
+                voice.left  = voice.targetLeft;
+                voice.right = voice.targetRight;
+            }
+        }
+
+        if (voice.stopping && voice.ramp == 0)
+        {
+            EndVoice(voice);
+            return;
+        }
+
+        if (voice.position == clip->frames)
+        {
+            if (!voice.loop)
+            {
+                EndVoice(voice);
+                return;
+            }
+            voice.position = 0;
+        }
+    }
+}
+
+void AudioEngine::EndVoice(Voice& voice)
+{
+    SDL_AtomicAdd(&voice.clip->users, -1);
+    voice.id   = 0;
+    voice.clip = NULL;
+}
+
+AudioEngine::Voice* AudioEngine::FindVoice(Uint32 id)
+{
+    for (int i = 0; i < kMaxVoices; ++i)
+        if (voices_[i].id == id) return &voices_[i];
+    return NULL;
+}
+
+void AudioEngine::GetGains(float volume, float pan, float& left, float& right)
+{
+    volume = SDL_max(0.f, SDL_min(volume, 1.f));
+    pan    = SDL_max(-1.f, SDL_min(pan, 1.f));
+    left   = volume * SDL_min(1.f, 1.f - pan);
+    right  = volume * SDL_min(1.f, 1.f + pan);
+}
@@ -0,0 +1,171 @@
+#ifndef AUDIO_ENGINE_H_
+#define AUDIO_ENGINE_H_
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_mixer.h"
+
+#include "metrics.h"
+
+// A sound ready to mix: interleaved stereo S16 samples at the device's rate.
+struct AudioClip
+{
+    const Sint16*        samples;
+    int                  frames;
+    // The voices playing the clip or queued to; its samples may only be
+    // freed at 0.
+    mutable SDL_atomic_t users;
+};
+
+// What the game thread asks of the audio callback.
+struct AudioCommand
+{
+    enum Type
+    {
+        kPlay,
+        kStop,
+        kSetVolume,
+        kStopAll
+    };
+
+    Type             type;
+    Uint32           voice;
+    const AudioClip* clip;
+    // 0 to 1, and -1 (left) to 1 (right).
+    float            volume;
+    float            pan;
+    bool             loop;
+};
+
+// What the audio callback cost over a stretch of callbacks.
+struct AudioCallbackStats
+{
+    int    callbacks;
+    // The mixing time over the time the buffers last, on average and at worst.
+    double meanLoad;
+    double maxLoad;
+    // The callbacks that took longer than their buffer lasts, or came so late
+    // the buffer before had run dry.
+    int    underruns;
+};
+
+// A lock-free ring of commands between one producer and one consumer. Each
+// side only writes its own index; the consumer never allocates or waits.
+class AudioCommandQueue
+{
+public:
+    static const int kCapacity = 1024;
+
+    AudioCommandQueue();
+
+    // Producer side; false when the ring is full.
+    bool Push(const AudioCommand& command);
+    // Consumer side; false when the ring is empty.
+    bool Pop(AudioCommand& command);
+
+private:
+    AudioCommand commands_[kCapacity];
+    SDL_atomic_t head_;
+    SDL_atomic_t tail_;
+};
+
+// The audio subsystem. SDL_mixer owns the device and its music; our voices
+// are mixed on top in its post-mix callback. The game thread posts commands
+// through a lock-free ring that the callback drains, so triggering sounds
+// never waits on the audio thread, and the callback never locks or
+// allocates. Play() and the other commands must come from one thread.
+class AudioEngine
+{
+public:
+    // The voices mixed at once; sounds past that are dropped.
+    static const int kMaxVoices = 128;
+    // The frames mixed per pass of the callback.
+    static const int kMixFrames = 1024;
+    // The frames a voice takes to fade in, out or to a new volume.
+    static const int kRampFrames = 64;
+
+    AudioEngine();
+    ~AudioEngine();
+
+    // Open the device with a buffer of bufferFrames; small buffers mean low
+    // latency.
+    bool Open(int frequency, int bufferFrames);
+    void Close();
+    bool IsOpen() { return open_; }
+
+    // Returns the voice id for Stop() and SetVolume(); 0 when the command
+    // ring is full.
+    Uint32 Play(const AudioClip* clip, float volume = 1.f, float pan = 0.f, bool loop = false);
+    void   Stop(Uint32 voice);
+    void   SetVolume(Uint32 voice, float volume, float pan);
+    void   StopAll();
+
+    // The voices playing as of the last callback, and what got dropped.
+    int GetActiveVoices() { return SDL_AtomicGet(&activeVoices_); }
+    int GetDroppedCommands() { return SDL_AtomicGet(&droppedCommands_); }
+    int GetDroppedVoices() { return SDL_AtomicGet(&droppedVoices_); }
+
+    // Register the callback's metrics and feed them. Set before Open().
+    void SetMetrics(Metrics* metrics);
+
+    // The callbacks since the last reset, which the callback itself applies
+    // on its next run.
+    void GetCallbackStats(AudioCallbackStats& stats);
+    void ResetCallbackStats() { SDL_AtomicSet(&resetStats_, 1); }
+
+private:
+    struct Voice
+    {
+        // 0 while free.
+        Uint32           id;
+        const AudioClip* clip;
+        int              position;
+        bool             loop;
+        bool             stopping;
+        // The gains, and the ones they reach in ramp frames.
+        float            left;
+        float            right;
+        float            targetLeft;
+        float            targetRight;
+        int              ramp;
+    };
+
+    static void SDLCALL PostMix(void* udata, Uint8* stream, int len);
+    void Post(const AudioCommand& command);
+    // The audio thread's side.
+    void Mix(Sint16* stream, int frames);
+    void Apply(const AudioCommand& command);
+    void MixVoice(Voice& voice, int frames);
+    // Free the voice and let go of its clip.
+    void EndVoice(Voice& voice);
+    Voice* FindVoice(Uint32 id);
+    static void GetGains(float volume, float pan, float& left, float& right);
+
+    bool              open_;
+    AudioCommandQueue commands_;
+    Uint32            nextVoice_;
+
+    // Only touched by the callback.
+    Voice             voices_[kMaxVoices];
+    float*            mix_;
+
+    SDL_atomic_t      activeVoices_;
+    SDL_atomic_t      droppedCommands_;
+    SDL_atomic_t      droppedVoices_;
+
+    // In microseconds, written by the callback only.
+    SDL_atomic_t      callbacks_;
+    SDL_atomic_t      mixTime_;
+    SDL_atomic_t      bufferTime_;
+    SDL_atomic_t      maxLoad_;
+    SDL_atomic_t      underruns_;
+    SDL_atomic_t      resetStats_;
+    Uint64            lastCallback_;
+    int               frequency_;
+
+    // NULL without metrics.
+    MetricHistogram*  callbackTimeMetric_;
+    MetricGauge*      voicesMetric_;
+    MetricCounter*    droppedVoicesMetric_;
+};
+
+#endif  // AUDIO_ENGINE_H_
@@ -0,0 +1,323 @@
+#include "blitter.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BLITTER_X86 1
+#include <immintrin.h>
+#endif
+
+// Rounded x / 255 for x <= 255 * 255.
+static inline Uint32 Div255(Uint32 x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static void BlendSpanScalar(Uint32* dst, const Uint32* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Uint32 s   = src[i];
+        Uint32 inv = 255 - (s >> 24);
+        if (inv == 255) continue;
+        if (inv == 0)
+        {
+            dst[i] = s;
+            continue;
+        }
+
+        Uint32 d = dst[i];
+        Uint32 b = (s & 0xFF)         + Div255((d & 0xFF) * inv);
+        Uint32 g = ((s >> 8) & 0xFF)  + Div255(((d >> 8) & 0xFF) * inv);
+        Uint32 r = ((s >> 16) & 0xFF) + Div255(((d >> 16) & 0xFF) * inv);
+        Uint32 a = (s >> 24)          + Div255((d >> 24) * inv);
+        dst[i] = (SDL_min(a, 255u) << 24) | (SDL_min(r, 255u) << 16) |
+                 (SDL_min(g, 255u) << 8) | SDL_min(b, 255u);
+    }
+}
+
+#ifdef BLITTER_X86
+// Multiply 2 pixels unpacked to 16 bits per channel, rounded like Div255().
+static inline __m128i Multiply2x16(__m128i a, __m128i b)
+{
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Blend 2 pixels unpacked to 16 bits per channel.
+static inline __m128i Blend2x16(__m128i d, __m128i invSrc)
+{
+    // Broadcast the inverted alpha of each pixel to its four channels.
+    return Multiply2x16(d, _mm_shufflehi_epi16(_mm_shufflelo_epi16(invSrc, 0xFF), 0xFF));
+}
+
+static void BlendSpanSSE2(Uint32* dst, const Uint32* src, int count)
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i ones  = _mm_set1_epi32(-1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i a = _mm_and_si128(s, alpha);
+
+        // Skip fully transparent pixels and copy fully opaque ones.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xFFFF) continue;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, alpha)) == 0xFFFF)
+        {
+            _mm_storeu_si128((__m128i*)(dst + i), s);
+            continue;
+        }
+
+        __m128i d   = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i inv = _mm_xor_si128(s, ones);
+        __m128i lo  = Blend2x16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero));
+        __m128i hi  = Blend2x16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+    }
+
+    BlendSpanScalar(dst + i, src + i, count - i);
+}
+
+#if defined(__GNUC__)
+#define BLITTER_AVX2 1
+
+__attribute__((target("avx2")))
+static inline __m256i Blend2x16AVX2(__m256i d, __m256i invSrc)
+{
+    __m256i inv = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(invSrc, 0xFF), 0xFF);
+    __m256i x   = _mm256_add_epi16(_mm256_mullo_epi16(d, inv), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void BlendSpanAVX2(Uint32* dst, const Uint32* src, int count)
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i ones  = _mm256_set1_epi32(-1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i a = _mm256_and_si256(s, alpha);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, zero)) == -1) continue;
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, alpha)) == -1)
+        {
+            _mm256_storeu_si256((__m256i*)(dst + i), s);
+            continue;
+        }
+
+        // Unpack and pack both work within 128 bit lanes, so the pixel order
+        // comes back unchanged.
+        __m256i d   = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i inv = _mm256_xor_si256(s, ones);
+        __m256i lo  = Blend2x16AVX2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(inv, zero));
+        __m256i hi  = Blend2x16AVX2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(inv, zero));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s));
+    }
+
+    BlendSpanSSE2(dst + i, src + i, count - i);
+}
+#endif  // __GNUC__
+#endif  // BLITTER_X86
+
+typedef void (*BlendSpanFunc)(Uint32* dst, const Uint32* src, int count);
+
+static const char* g_blendSpanName = "scalar";
+
+// Pick the widest span blender the CPU supports.
+static BlendSpanFunc SelectBlendSpan()
+{
+#ifdef BLITTER_AVX2
+    if (SDL_HasAVX2())
+    {
+        g_blendSpanName = "avx2";
+        return BlendSpanAVX2;
+    }
+#endif
+#ifdef BLITTER_X86
+    if (SDL_HasSSE2())
+    {
+        g_blendSpanName = "sse2";
+        return BlendSpanSSE2;
+    }
+#endif
+    g_blendSpanName = "scalar";
+    return BlendSpanScalar;
+}
+
+// Picked once at startup, before any tile worker can blend.
+static const BlendSpanFunc g_blendSpan = SelectBlendSpan();
+
+void BlendSpan(Uint32* dst, const Uint32* src, int count)
+{
+    g_blendSpan(dst, src, count);
+}
+
+void BlendFillSpan(Uint32* dst, Uint32 color, int count)
+{
+    Uint32 inv = 255 - (color >> 24);
+    if (inv == 255) return;
+    if (inv == 0)
+    {
+        for (int i = 0; i < count; ++i) dst[i] = color;
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        Uint32 d = dst[i];
+        dst[i] = (((color >> 24) + Div255((d >> 24) * inv)) << 24) |
+                 ((((color >> 16) & 0xFF) + Div255(((d >> 16) & 0xFF) * inv)) << 16) |
+                 ((((color >> 8) & 0xFF) + Div255(((d >> 8) & 0xFF) * inv)) << 8) |
+                 ((color & 0xFF) + Div255((d & 0xFF) * inv));
+    }
+}
+
+void BlendTintSpan(Uint32* dst, const Uint32* src, Uint32 color, int count)
+{
+    int i = 0;
+#ifdef BLITTER_X86
+    // Sprites are narrow, SSE2 is plenty.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i tint = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        s = _mm_packus_epi16(Multiply2x16(_mm_unpacklo_epi8(s, zero), tint),
+                             Multiply2x16(_mm_unpackhi_epi8(s, zero), tint));
+
+        __m128i d   = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i inv = _mm_xor_si128(s, ones);
+        __m128i lo  = Blend2x16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero));
+        __m128i hi  = Blend2x16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        Uint32 p = src[i];
+        Uint32 s = (Div255((p >> 24) * (color >> 24)) << 24) |
+                   (Div255(((p >> 16) & 0xFF) * ((color >> 16) & 0xFF)) << 16) |
+                   (Div255(((p >> 8) & 0xFF) * ((color >> 8) & 0xFF)) << 8) |
+                   Div255((p & 0xFF) * (color & 0xFF));
+        BlendSpanScalar(dst + i, &s, 1);
+    }
+}
+
+const char* GetBlendSpanName() { return g_blendSpanName; }
+
+Uint32 PremultiplyColor(SDL_Color color)
+{
+    Uint32 a = color.a;
+    return (a << 24) | ((color.r * a / 255) << 16) | ((color.g * a / 255) << 8) |
+           (color.b * a / 255);
+}
+
+bool PremultiplySurface(SDL_Surface* surface)
+{
+    if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) return false;
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0) return false;
+
+    for (int y = 0; y < surface->h; ++y)
+    {
+        Uint32* row = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x)
+        {
+            Uint32 p = row[x];
+            Uint32 a = p >> 24;
+            row[x] = (a << 24) |
+                     (Div255(((p >> 16) & 0xFF) * a) << 16) |
+                     (Div255(((p >> 8) & 0xFF) * a) << 8) |
+                     Div255((p & 0xFF) * a);
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    return true;
+}
+
+bool ClipBlit(BlitOp& op, const SDL_Rect* clip)
+{
+    SDL_Rect bounds = {0, 0, op.dst->w, op.dst->h};
+    if (clip != NULL && !SDL_IntersectRect(clip, &bounds, &bounds)) return false;
+
+    // Clip the source area against the source surface first.
+    SDL_Rect src = op.srcRect;
+    if (op.src != NULL)
+    {
+        SDL_Rect srcBounds = {0, 0, op.src->w, op.src->h};
+        if (!SDL_IntersectRect(&op.srcRect, &srcBounds, &src)) return false;
+    }
+
+    SDL_Rect dest = {op.x + src.x - op.srcRect.x, op.y + src.y - op.srcRect.y, src.w, src.h};
+    SDL_Rect visible;
+    if (!SDL_IntersectRect(&dest, &bounds, &visible)) return false;
+
+    op.srcRect.x = src.x + visible.x - dest.x;
+    op.srcRect.y = src.y + visible.y - dest.y;
+    op.srcRect.w = visible.w;
+    op.srcRect.h = visible.h;
+    op.x         = visible.x;
+    op.y         = visible.y;
+
+    return true;
+}
+
+void BlitRows(const BlitOp& op, int begin, int end)
+{
+    for (int row = begin; row < end; ++row)
+    {
+        Uint32* dst = (Uint32*)((Uint8*)op.dst->pixels + (op.y + row) * op.dst->pitch) + op.x;
+        if (op.src == NULL)
+        {
+            BlendFillSpan(dst, op.color, op.srcRect.w);
+            continue;
+        }
+
+        const Uint32* src = (const Uint32*)((const Uint8*)op.src->pixels +
+                                            (op.srcRect.y + row) * op.src->pitch) + op.srcRect.x;
+        if (op.color != 0) BlendTintSpan(dst, src, op.color, op.srcRect.w);
+        else               BlendSpan(dst, src, op.srcRect.w);
+    }
+}
+
+bool ConvertSurface(const SDL_Surface* src, SDL_Surface* dst, bool premultiply)
+{
+    if (src->format->format != SDL_PIXELFORMAT_ARGB8888 || dst->format->BytesPerPixel != 4 ||
+        src->w != dst->w || src->h != dst->h)
+        return false;
+    if (SDL_MUSTLOCK(dst) && SDL_LockSurface(dst) != 0) return false;
+
+    const SDL_PixelFormat* format = dst->format;
+    for (int y = 0; y < src->h; ++y)
+    {
+        const Uint32* in  = (const Uint32*)((const Uint8*)src->pixels + y * src->pitch);
+        Uint32*       out = (Uint32*)((Uint8*)dst->pixels + y * dst->pitch);
+        for (int x = 0; x < src->w; ++x)
+        {
+            Uint32 p = in[x];
+            Uint32 a = p >> 24;
+            Uint32 r = (p >> 16) & 0xFF;
+            Uint32 g = (p >> 8) & 0xFF;
+            Uint32 b = p & 0xFF;
+            if (premultiply)
+            {
+                r = Div255(r * a);
+                g = Div255(g * a);
+                b = Div255(b * a);
+            }
+            out[x] = (a << format->Ashift) | (r << format->Rshift) | (g << format->Gshift) |
+                     (b << format->Bshift);
+        }
+    }
+
+    if (SDL_MUSTLOCK(dst)) SDL_UnlockSurface(dst);
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef BLITTER_H_
+#define BLITTER_H_
+
+#include "SDL2/SDL.h"
+
+// Blends count premultiplied ARGB8888 source pixels over the destination,
+// dst = src + dst * (1 - src.a). Uses AVX2 or SSE2 when the CPU has them.
+void BlendSpan(Uint32* dst, const Uint32* src, int count);
+
+// Blends one premultiplied ARGB8888 color over count destination pixels.
+void BlendFillSpan(Uint32* dst, Uint32 color, int count);
+
+// Blends count premultiplied ARGB8888 source pixels multiplied by a
+// premultiplied color over the destination.
+void BlendTintSpan(Uint32* dst, const Uint32* src, Uint32 color, int count);
+
+// The name of the span blender picked for this CPU.
+const char* GetBlendSpanName();
+
+// The premultiplied ARGB8888 value of the color.
+Uint32 PremultiplyColor(SDL_Color color);
+
+// Converts an ARGB8888 surface to premultiplied alpha in place.
+bool PremultiplySurface(SDL_Surface* surface);
+
+// Copies an ARGB8888 surface into a 32-bit surface of the same size in
+// another channel order, premultiplying on the way on request.
+bool ConvertSurface(const SDL_Surface* src, SDL_Surface* dst, bool premultiply);
+
+// A clipped blit of a premultiplied ARGB8888 surface into an ARGB8888 target,
+// tinted by the color unless it's 0. Without a source surface it fills
+// srcRect's size with the color instead.
+struct BlitOp
+{
+    SDL_Surface*       dst;
+    const SDL_Surface* src;
+    // The source area, and the top left of the destination area.
+    SDL_Rect           srcRect;
+    int                x;
+    int                y;
+    Uint32             color;
+};
+
+// Clip the blit against clip (or the whole target when NULL). Returns false
+// when nothing is left to draw.
+bool ClipBlit(BlitOp& op, const SDL_Rect* clip);
+
+// Blend the rows [begin, end) of a clipped blit. Disjoint row ranges of the
+// same blit may run in parallel.
+void BlitRows(const BlitOp& op, int begin, int end);
+
+#endif  // BLITTER_H_
@@ -0,0 +1,148 @@
+#include "cached_layer.h"
+
+#include "blitter.h"
+#include "render_stats.h"
+#include "texture_format.h"
+
+CachedLayer::CachedLayer()
+    : texture_(NULL), surface_(NULL), scale_(1.f), version_(0), valid_(false)
+{
+    SDL_zero(bounds_);
+}
+
+CachedLayer::~CachedLayer() { Free(); }
+
+void CachedLayer::Free()
+{
+    if (texture_ != NULL) SDL_DestroyTexture(texture_);
+    if (surface_ != NULL) SDL_FreeSurface(surface_);
+
+    texture_ = NULL;
+    surface_ = NULL;
+    valid_   = false;
+}
+
+bool CachedLayer::IsStale(unsigned version, const SDL_Rect& bounds, float scale)
+{
+    return !valid_ || version != version_ || bounds.x != bounds_.x || bounds.y != bounds_.y ||
+           bounds.w != bounds_.w || bounds.h != bounds_.h || scale != scale_;
+}
+
+bool CachedLayer::BeginRender(SDL_Renderer* renderer, bool software, const SDL_Rect& bounds,
+                              float scale)
+{
+    valid_ = false;
+    if (bounds.w <= 0 || bounds.h <= 0) return false;
+
+    bool resized = bounds.w != bounds_.w || bounds.h != bounds_.h || scale != scale_;
+    bounds_ = bounds;
+    scale_  = scale;
+
+    if (software)
+    {
+        if (surface_ == NULL || resized)
+        {
+            Free();
+            surface_ = SDL_CreateRGBSurfaceWithFormat(0, bounds.w, bounds.h, 32,
+                                                      SDL_PIXELFORMAT_ARGB8888);
+            if (surface_ == NULL) return false;
+            CountTextureCreation();
+        }
+
+        SDL_FillRect(surface_, NULL, 0);
+        return true;
+    }
+
+    if (!SDL_RenderTargetSupported(renderer)) return false;
+    if (texture_ == NULL || resized)
+    {
+        Free();
+        texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                     (int)(bounds.w * scale + 0.5f),
+                                     (int)(bounds.h * scale + 0.5f));
+        if (texture_ == NULL) return false;
+        CountTextureCreation();
+
+        // The content is premultiplied; renderers without custom blend modes
+        // get slightly dark edges instead.
+        if (SDL_SetTextureBlendMode(texture_, GetPremultipliedBlendMode()) != 0)
+            SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+    }
+
+    // The target starts out unscaled; SDL restores the window's scale after.
+    if (SDL_SetRenderTarget(renderer, texture_) != 0) return false;
+    SDL_RenderSetScale(renderer, scale, scale);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    return true;
+}
+
+void CachedLayer::EndRender(SDL_Renderer* renderer, unsigned version)
+{
+    if (texture_ != NULL) SDL_SetRenderTarget(renderer, NULL);
+
+    version_ = version;
+    valid_   = true;
+}
+
+void CachedLayer::Blit(const SDL_Surface* src, const SDL_Rect* srcRect, int x, int y)
+{
+    BlitOp op;
+    op.dst   = surface_;
+    op.src   = src;
+    op.x     = x;
+    op.y     = y;
+    op.color = 0;
+    if (srcRect != NULL) op.srcRect = *srcRect;
+    else
+    {
+        op.srcRect.x = 0;
+        op.srcRect.y = 0;
+        op.srcRect.w = src->w;
+        op.srcRect.h = src->h;
+    }
+
+    if (ClipBlit(op, NULL)) BlitRows(op, 0, op.srcRect.h);
+}
+
+void CachedLayer::FillRect(const SDL_Rect& rect, SDL_Color color)
+{
+    BlitOp op;
+    op.dst       = surface_;
+    op.src       = NULL;
+    op.srcRect.x = 0;
+    op.srcRect.y = 0;
+    op.srcRect.w = rect.w;
+    op.srcRect.h = rect.h;
+    op.x         = rect.x;
+    op.y         = rect.y;
+    op.color     = PremultiplyColor(color);
+
+    if (ClipBlit(op, NULL)) BlitRows(op, 0, op.srcRect.h);
+}
+
+void CachedLayer::Draw(SDL_Renderer* renderer)
+{
+    SDL_FRect destRect = {(float)bounds_.x, (float)bounds_.y, (float)bounds_.w, (float)bounds_.h};
+    Draw(renderer, destRect, 0.0);
+}
+
+void CachedLayer::Draw(Framebuffer& framebuffer) { Draw(framebuffer, bounds_.x, bounds_.y); }
+
+void CachedLayer::Draw(SDL_Renderer* renderer, const SDL_FRect& destRect, double angle)
+{
+    if (angle == 0.0) SDL_RenderCopyF(renderer, texture_, NULL, &destRect);
+    else
+    {
+        SDL_FPoint topLeft = {0.f, 0.f};
+        SDL_RenderCopyExF(renderer, texture_, NULL, &destRect, angle, &topLeft, SDL_FLIP_NONE);
+    }
+    CountDrawCalls(1);
+}
+
+void CachedLayer::Draw(Framebuffer& framebuffer, int x, int y)
+{
+    framebuffer.Blit(surface_, NULL, x, y);
+}
@@ -0,0 +1,63 @@
+#ifndef CACHED_LAYER_H_
+#define CACHED_LAYER_H_
+
+#include "SDL2/SDL.h"
+
+#include "framebuffer.h"
+
+// A group of rarely changing draws rendered once into a texture of its own,
+// then drawn as a single quad until it's invalidated. The render thread keeps
+// one per layer id of the frame packets.
+//
+// With a hardware renderer the content goes through SDL_SetRenderTarget into
+// a target texture; blending onto the transparent target leaves premultiplied
+// pixels, which get composited with a premultiplied blend mode. With the
+// software renderer the content is blended straight into a premultiplied
+// surface that the framebuffer blits like any other.
+class CachedLayer
+{
+public:
+    CachedLayer();
+    ~CachedLayer();
+
+    void Free();
+
+    // Force the next frame to render the content again.
+    void Invalidate() { valid_ = false; }
+
+    // Whether the content of the version has to be rendered again, at the
+    // renderer's output pixels per logical pixel.
+    bool IsStale(unsigned version, const SDL_Rect& bounds, float scale);
+
+    // Render the content of bounds between these. Returns false when the
+    // layer can't be cached, then the content has to be drawn directly.
+    // A hardware layer is rendered at the scale so its content stays sharp;
+    // a software one always at 1.
+    bool BeginRender(SDL_Renderer* renderer, bool software, const SDL_Rect& bounds, float scale);
+    void EndRender(SDL_Renderer* renderer, unsigned version);
+
+    // Software content, relative to the layer's top left.
+    void Blit(const SDL_Surface* src, const SDL_Rect* srcRect, int x, int y);
+    void FillRect(const SDL_Rect& rect, SDL_Color color);
+
+    // Draw the cached content as one quad.
+    void Draw(SDL_Renderer* renderer);
+    void Draw(Framebuffer& framebuffer);
+    // The same elsewhere, for content that moves around: stretched over the
+    // rect and turned clockwise by the angle in degrees around its top left,
+    // or unscaled at x, y in software.
+    void Draw(SDL_Renderer* renderer, const SDL_FRect& destRect, double angle);
+    void Draw(Framebuffer& framebuffer, int x, int y);
+
+    const SDL_Rect& GetBounds() { return bounds_; }
+
+private:
+    SDL_Texture*  texture_;
+    SDL_Surface*  surface_;
+    SDL_Rect      bounds_;
+    float         scale_;
+    unsigned      version_;
+    bool          valid_;
+};
+
+#endif  // CACHED_LAYER_H_
@@ -0,0 +1,216 @@
+#include "camera.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CAMERA_X86 1
+#include <immintrin.h>
+#endif
+
+const float Camera::kMinZoom = 0.25f;
+const float Camera::kMaxZoom = 8.f;
+
+static void TransformPointsScalar(float* x, float* y, int count, float a, float b, float tx,
+                                  float ty)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float wx = x[i];
+        float wy = y[i];
+        x[i]     = a * wx - b * wy + tx;
+        y[i]     = b * wx + a * wy + ty;
+    }
+}
+
+#ifdef CAMERA_X86
+static void TransformPointsSSE2(float* x, float* y, int count, float a, float b, float tx,
+                                float ty)
+{
+    const __m128 va  = _mm_set1_ps(a);
+    const __m128 vb  = _mm_set1_ps(b);
+    const __m128 vtx = _mm_set1_ps(tx);
+    const __m128 vty = _mm_set1_ps(ty);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 wx = _mm_loadu_ps(x + i);
+        __m128 wy = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(va, wx), _mm_mul_ps(vb, wy)), vtx));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vb, wx), _mm_mul_ps(va, wy)), vty));
+    }
+
+    TransformPointsScalar(x + i, y + i, count - i, a, b, tx, ty);
+}
+
+#if defined(__GNUC__)
+#define CAMERA_AVX 1
+
+__attribute__((target("avx")))
+static void TransformPointsAVX(float* x, float* y, int count, float a, float b, float tx,
+                               float ty)
+{
+    const __m256 va  = _mm256_set1_ps(a);
+    const __m256 vb  = _mm256_set1_ps(b);
+    const __m256 vtx = _mm256_set1_ps(tx);
+    const __m256 vty = _mm256_set1_ps(ty);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 wx = _mm256_loadu_ps(x + i);
+        __m256 wy = _mm256_loadu_ps(y + i);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(va, wx),
+                                                            _mm256_mul_ps(vb, wy)), vtx));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vb, wx),
+                                                            _mm256_mul_ps(va, wy)), vty));
+    }
+
+    TransformPointsSSE2(x + i, y + i, count - i, a, b, tx, ty);
+}
+#endif  // __GNUC__
+#endif  // CAMERA_X86
+
+typedef void (*TransformPointsFunc)(float* x, float* y, int count, float a, float b, float tx,
+                                    float ty);
+
+static TransformPointsFunc g_transformPoints     = NULL;
+static const char*         g_transformPointsName = "scalar";
+
+// Pick the widest transform kernel the CPU supports.
+static TransformPointsFunc SelectTransformPoints()
+{
+#ifdef CAMERA_AVX
+    if (SDL_HasAVX())
+    {
+        g_transformPointsName = "avx";
+        return TransformPointsAVX;
+    }
+#endif
+#ifdef CAMERA_X86
+    if (SDL_HasSSE2())
+    {
+        g_transformPointsName = "sse2";
+        return TransformPointsSSE2;
+    }
+#endif
+    g_transformPointsName = "scalar";
+    return TransformPointsScalar;
+}
+
+const char* GetCameraKernelName()
+{
+    if (g_transformPoints == NULL) g_transformPoints = SelectTransformPoints();
+    return g_transformPointsName;
+}
+
+Camera::Camera() : x_(0.f), y_(0.f), zoom_(1.f), rotation_(0.f), width_(0), height_(0)
+{
+    SDL_zero(bounds_);
+    UpdateTransform();
+}
+
+void Camera::SetViewport(int width, int height)
+{
+    width_  = width;
+    height_ = height;
+    Clamp();
+}
+
+void Camera::SetPosition(float x, float y)
+{
+    x_ = x;
+    y_ = y;
+    Clamp();
+}
+
+void Camera::Move(float dx, float dy) { SetPosition(x_ + dx, y_ + dy); }
+
+void Camera::SetZoom(float zoom)
+{
+    zoom_ = SDL_max(kMinZoom, SDL_min(zoom, kMaxZoom));
+    Clamp();
+}
+
+void Camera::SetRotation(float degrees)
+{
+    rotation_ = SDL_fmodf(degrees, 360.f);
+    Clamp();
+}
+
+void Camera::SetBounds(const SDL_FRect& bounds)
+{
+    bounds_ = bounds;
+    Clamp();
+}
+
+SDL_FRect Camera::GetVisibleRect()
+{
+    // The half extents of the rotated screen's bounding box, in world units.
+    float c          = SDL_fabsf(a_) / zoom_;
+    float s          = SDL_fabsf(b_) / zoom_;
+    float halfWidth  = (c * width_ + s * height_) / (2.f * zoom_);
+    float halfHeight = (s * width_ + c * height_) / (2.f * zoom_);
+
+    SDL_FRect rect = {x_ - halfWidth, y_ - halfHeight, 2.f * halfWidth, 2.f * halfHeight};
+    return rect;
+}
+
+bool Camera::IsVisible(const SDL_FRect& bounds)
+{
+    SDL_FRect view = GetVisibleRect();
+    return bounds.x <= view.x + view.w && view.x <= bounds.x + bounds.w &&
+           bounds.y <= view.y + view.h && view.y <= bounds.y + bounds.h;
+}
+
+void Camera::WorldToScreen(float x, float y, float& screenX, float& screenY)
+{
+    screenX = a_ * x - b_ * y + tx_;
+    screenY = b_ * x + a_ * y + ty_;
+}
+
+void Camera::ScreenToWorld(float x, float y, float& worldX, float& worldY)
+{
+    // The transpose undoes the rotation; the zoom comes out twice.
+    float dx    = x - tx_;
+    float dy    = y - ty_;
+    float scale = zoom_ * zoom_;
+    worldX      = (a_ * dx + b_ * dy) / scale;
+    worldY      = (a_ * dy - b_ * dx) / scale;
+}
+
+void Camera::Apply(FramePacket* packet, int first)
+{
+    if (g_transformPoints == NULL) g_transformPoints = SelectTransformPoints();
+
+    int count = (int)packet->sprites.x.size() - first;
+    if (count > 0)
+        g_transformPoints(&packet->sprites.x[first], &packet->sprites.y[first], count, a_, b_,
+                          tx_, ty_);
+
+    packet->viewScale = zoom_;
+    packet->viewAngle = rotation_;
+}
+
+void Camera::Clamp()
+{
+    UpdateTransform();
+    if (bounds_.w <= 0.f || bounds_.h <= 0.f) return;
+
+    SDL_FRect view       = GetVisibleRect();
+    float     halfWidth  = view.w / 2.f;
+    float     halfHeight = view.h / 2.f;
+    if (view.w >= bounds_.w) x_ = bounds_.x + bounds_.w / 2.f;
+    else x_ = SDL_max(bounds_.x + halfWidth, SDL_min(x_, bounds_.x + bounds_.w - halfWidth));
+    if (view.h >= bounds_.h) y_ = bounds_.y + bounds_.h / 2.f;
+    else y_ = SDL_max(bounds_.y + halfHeight, SDL_min(y_, bounds_.y + bounds_.h - halfHeight));
+
+    UpdateTransform();
+}
+
+void Camera::UpdateTransform()
+{
+    float radians = rotation_ * (float)M_PI / 180.f;
+    a_            = SDL_cosf(radians) * zoom_;
+    b_            = SDL_sinf(radians) * zoom_;
+    tx_           = width_ / 2.f - a_ * x_ + b_ * y_;
+    ty_           = height_ / 2.f - b_ * x_ - a_ * y_;
+}
@@ -0,0 +1,73 @@
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+#include "SDL2/SDL.h"
+
+#include "frame_packet.h"
+
+// The view of the world a window shows: the world point at the center of the
+// screen, a zoom and a rotation, optionally kept inside the world's bounds.
+// World positions go through it on the game thread, in bulk with SSE or AVX
+// kernels; the render thread then draws to the subpixel with
+// SDL_RenderCopyF() and SDL_RenderCopyExF() at the packet's view scale and
+// angle.
+class Camera
+{
+public:
+    static const float kMinZoom;
+    static const float kMaxZoom;
+
+    Camera();
+
+    // The screen size in logical pixels.
+    void SetViewport(int width, int height);
+    void SetPosition(float x, float y);
+    void Move(float dx, float dy);
+    // Clamped to kMinZoom to kMaxZoom.
+    void SetZoom(float zoom);
+    // Clockwise, in degrees.
+    void SetRotation(float degrees);
+    // Keep everything in view inside the bounds, or the bounds centered when
+    // they're smaller than the view. None when they have no size.
+    void SetBounds(const SDL_FRect& bounds);
+
+    float GetX() { return x_; }
+    float GetY() { return y_; }
+    float GetZoom() { return zoom_; }
+    float GetRotation() { return rotation_; }
+
+    // The world area in view, bounding the rotated screen.
+    SDL_FRect GetVisibleRect();
+    bool      IsVisible(const SDL_FRect& bounds);
+
+    void WorldToScreen(float x, float y, float& screenX, float& screenY);
+    void ScreenToWorld(float x, float y, float& worldX, float& worldY);
+
+    // Move the packet's sprites from first on from world to screen positions
+    // in place, and set the packet's view to the camera's zoom and rotation.
+    void Apply(FramePacket* packet, int first);
+
+private:
+    // Move the center back inside the bounds.
+    void Clamp();
+    void UpdateTransform();
+
+    float     x_;
+    float     y_;
+    float     zoom_;
+    float     rotation_;
+    int       width_;
+    int       height_;
+    SDL_FRect bounds_;
+
+    // World to screen is screen = (a * x - b * y + tx, b * x + a * y + ty).
+    float     a_;
+    float     b_;
+    float     tx_;
+    float     ty_;
+};
+
+// Which transform kernel runs: "avx", "sse2" or "scalar".
+const char* GetCameraKernelName();
+
+#endif  // CAMERA_H_
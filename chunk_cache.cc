@@ -0,0 +1,186 @@
+#include "chunk_cache.h"
+
+#include "blitter.h"
+#include "render_stats.h"
+
+// The key of a chunk of the map.
+static Uint64 GetKey(const TileChunk& chunk)
+{
+    return ((Uint64)(Uint32)chunk.y << 32) | (Uint32)chunk.x;
+}
+
+ChunkCache::ChunkCache()
+    : tileset_(NULL), tilesetSurface_(NULL), tick_(0), frame_(0), builds_(0)
+{
+}
+
+ChunkCache::~ChunkCache() { Free(); }
+
+bool ChunkCache::Create(SDL_Renderer* renderer, TextureFormat& format)
+{
+    Free();
+
+    SDL_Surface* tileset = Rasterize();
+    if (tileset == NULL) return false;
+
+    // The software renderer composites from premultiplied surfaces.
+    if (format.IsSoftware())
+    {
+        CountTextureCreation();
+        tilesetSurface_ = tileset;
+        if (!PremultiplySurface(tilesetSurface_))
+        {
+            Free();
+            return false;
+        }
+        return true;
+    }
+
+    tileset_ = format.CreateTexture(renderer, tileset);
+    SDL_FreeSurface(tileset);
+
+    return tileset_ != NULL;
+}
+
+void ChunkCache::Free()
+{
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        delete it->second.layer;
+    entries_.clear();
+
+    if (tileset_ != NULL) SDL_DestroyTexture(tileset_);
+    if (tilesetSurface_ != NULL) SDL_FreeSurface(tilesetSurface_);
+
+    tileset_        = NULL;
+    tilesetSurface_ = NULL;
+}
+
+void ChunkCache::Draw(SDL_Renderer* renderer, const TileChunk& chunk, const SDL_FPoint& point,
+                      float viewScale, float viewAngle, float scale)
+{
+    // Cached at the output's density only, so zooming never renders again.
+    CachedLayer* layer = Prepare(renderer, false, chunk, scale);
+    if (layer != NULL)
+    {
+        float     size     = TileChunk::kSize * viewScale;
+        SDL_FRect destRect = {point.x, point.y, size, size};
+        layer->Draw(renderer, destRect, viewAngle);
+    }
+    else DrawTiles(renderer, NULL, NULL, chunk, (int)point.x, (int)point.y);
+}
+
+void ChunkCache::Draw(Framebuffer& framebuffer, const TileChunk& chunk, int x, int y)
+{
+    CachedLayer* layer = Prepare(NULL, true, chunk, 1.f);
+    if (layer != NULL) layer->Draw(framebuffer, x, y);
+    else               DrawTiles(NULL, NULL, &framebuffer, chunk, x, y);
+}
+
+CachedLayer* ChunkCache::Prepare(SDL_Renderer* renderer, bool software, const TileChunk& chunk,
+                                 float scale)
+{
+    // Marked used first so the eviction spares it.
+    Entry& entry    = entries_[GetKey(chunk)];
+    entry.lastUse   = ++tick_;
+    entry.lastFrame = frame_;
+    if (entry.layer == NULL)
+    {
+        entry.layer = new CachedLayer;
+        Evict();
+    }
+
+    // Laid out at the origin; drawn wherever the chunk is on screen.
+    CachedLayer*   layer  = entry.layer;
+    const SDL_Rect bounds = {0, 0, TileChunk::kSize, TileChunk::kSize};
+    if (!layer->IsStale(chunk.version, bounds, scale)) return layer;
+    if (!layer->BeginRender(renderer, software, bounds, scale)) return NULL;
+
+    ++builds_;
+    DrawTiles(renderer, software ? layer : NULL, NULL, chunk, 0, 0);
+    layer->EndRender(renderer, chunk.version);
+    return layer;
+}
+
+void ChunkCache::DrawTiles(SDL_Renderer* renderer, CachedLayer* layer, Framebuffer* framebuffer,
+                           const TileChunk& chunk, int left, int top)
+{
+    int drawn = 0;
+    for (int i = 0; i < TileChunk::kTiles * TileChunk::kTiles; ++i)
+    {
+        int tile = chunk.tiles[i];
+        if (tile == 0 || tile > kTileCount) continue;
+
+        SDL_Rect srcRect = {(tile - 1) * TileChunk::kTileSize, 0, TileChunk::kTileSize,
+                            TileChunk::kTileSize};
+        int      x       = left + i % TileChunk::kTiles * TileChunk::kTileSize;
+        int      y       = top + i / TileChunk::kTiles * TileChunk::kTileSize;
+        if (layer != NULL)            layer->Blit(tilesetSurface_, &srcRect, x, y);
+        else if (framebuffer != NULL) framebuffer->Blit(tilesetSurface_, &srcRect, x, y);
+        else
+        {
+            SDL_Rect destRect = {x, y, TileChunk::kTileSize, TileChunk::kTileSize};
+            SDL_RenderCopy(renderer, tileset_, &srcRect, &destRect);
+            ++drawn;
+        }
+    }
+    CountDrawCalls(drawn);
+}
+
+void ChunkCache::Evict()
+{
+    // Few enough to just scan for the least recently drawn.
+    while ((int)entries_.size() > kMaxChunks)
+    {
+        EntryMap::iterator oldest = entries_.end();
+        for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        {
+            if (it->second.lastFrame == frame_) continue;
+            if (oldest == entries_.end() || it->second.lastUse < oldest->second.lastUse)
+                oldest = it;
+        }
+        // Everything is on screen; evicting any of it would render it again
+        // every frame.
+        if (oldest == entries_.end()) return;
+
+        delete oldest->second.layer;
+        entries_.erase(oldest);
+    }
+}
+
+SDL_Surface* ChunkCache::Rasterize()
+{
+    SDL_Surface* tileset = SDL_CreateRGBSurfaceWithFormat(0, kTileCount * TileChunk::kTileSize,
+                                                          TileChunk::kTileSize, 32,
+                                                          SDL_PIXELFORMAT_ARGB8888);
+    if (tileset == NULL) return NULL;
+
+    // Grass, water, sand, stone, dirt, snow, brick and wood, each with a
+    // darker edge and a bit of fixed noise so the tiles read as a grid.
+    static const Uint32 kColors[kTileCount] = {0x4C9A3A, 0x2F6FBF, 0xD8C27A, 0x8A8A8A,
+                                               0x7A5230, 0xEDEFF2, 0xA0432F, 0xB07A45};
+    Uint32 seed = 7;
+    for (int tile = 0; tile < kTileCount; ++tile)
+    {
+        for (int y = 0; y < TileChunk::kTileSize; ++y)
+        {
+            Uint32* row = (Uint32*)((Uint8*)tileset->pixels + y * tileset->pitch) +
+                          tile * TileChunk::kTileSize;
+            for (int x = 0; x < TileChunk::kTileSize; ++x)
+            {
+                seed = seed * 1664525 + 1013904223;
+                bool edge  = x == 0 || y == 0 || x == TileChunk::kTileSize - 1 ||
+                             y == TileChunk::kTileSize - 1;
+                int  shade = edge ? 160 : 232 + (int)(seed >> 28);
+
+                Uint32 color = kColors[tile];
+                Uint32 r     = ((color >> 16) & 0xFF) * shade / 255;
+                Uint32 g     = ((color >> 8) & 0xFF) * shade / 255;
+                Uint32 b     = (color & 0xFF) * shade / 255;
+                row[x]       = 0xFF000000 | (SDL_min(r, 255u) << 16) | (SDL_min(g, 255u) << 8) |
+                               SDL_min(b, 255u);
+            }
+        }
+    }
+
+    return tileset;
+}
@@ -0,0 +1,79 @@
+#ifndef CHUNK_CACHE_H_
+#define CHUNK_CACHE_H_
+
+#include <map>
+
+#include "SDL2/SDL.h"
+
+#include "cached_layer.h"
+#include "frame_packet.h"
+#include "framebuffer.h"
+#include "texture_format.h"
+
+// The render thread's prerendered tilemap chunks. A chunk's tiles are drawn
+// into a cached layer of its own the first time it shows up and again only
+// when its version changes; every frame after that it's one quad. The least
+// recently drawn chunks get evicted past kMaxChunks, so scrolling around a
+// big map keeps memory flat. Chunks drawn in the current frame are never
+// evicted; with more than kMaxChunks on screen the cache grows instead.
+class ChunkCache
+{
+public:
+    // The chunks kept, a few screens' worth.
+    static const int kMaxChunks = 32;
+    // The tiles of the generated tileset, 1 on; 0 is always empty.
+    static const int kTileCount = 8;
+
+    ChunkCache();
+    ~ChunkCache();
+
+    bool Create(SDL_Renderer* renderer, TextureFormat& format);
+    void Free();
+
+    // Call before drawing each frame's chunks.
+    void BeginFrame() { ++frame_; }
+
+    // Draw the chunk with its top left at the point, zoomed and turned by the
+    // packet's view, rendering it first if needed at the output pixels per
+    // logical pixel. The software renderer can't zoom or turn.
+    void Draw(SDL_Renderer* renderer, const TileChunk& chunk, const SDL_FPoint& point,
+              float viewScale, float viewAngle, float scale);
+    void Draw(Framebuffer& framebuffer, const TileChunk& chunk, int x, int y);
+
+    // The chunks rendered so far.
+    int GetBuilds() { return builds_; }
+
+private:
+    struct Entry
+    {
+        CachedLayer* layer;
+        unsigned     lastUse;
+        unsigned     lastFrame;
+    };
+
+    typedef std::map<Uint64, Entry> EntryMap;
+
+    // The chunk's layer, rendered if stale; NULL when it can't be cached,
+    // then the tiles get drawn directly.
+    CachedLayer* Prepare(SDL_Renderer* renderer, bool software, const TileChunk& chunk,
+                         float scale);
+    // The tiles one by one into the layer when given, else the framebuffer
+    // when given, else the renderer.
+    void DrawTiles(SDL_Renderer* renderer, CachedLayer* layer, Framebuffer* framebuffer,
+                   const TileChunk& chunk, int left, int top);
+    void Evict();
+    // The straight alpha ARGB8888 tileset.
+    static SDL_Surface* Rasterize();
+
+    SDL_Texture*  tileset_;
+    // The premultiplied tileset kept instead of a texture for software
+    // rendering.
+    SDL_Surface*  tilesetSurface_;
+
+    EntryMap      entries_;
+    unsigned      tick_;
+    unsigned      frame_;
+    int           builds_;
+};
+
+#endif  // CHUNK_CACHE_H_
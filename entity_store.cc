@@ -0,0 +1,175 @@
+#include "entity_store.h"
+
+static const Uint32 kIndexMask = EntityStore::kMaxEntities - 1;
+
+// The generation after this one, never 0 so no handle is ever 0.
+static Uint32 NextGeneration(Uint32 generation)
+{
+    Uint32 next = (generation + 1) & (0xFFFFFFFFu >> EntityStore::kIndexBits);
+    return next == 0 ? 1 : next;
+}
+
+EntityStore::EntityStore() {}
+
+Entity EntityStore::Create(float x, float y, float vx, float vy, Uint8 sprite, SDL_Color color)
+{
+    Uint32 index;
+    if (!freeIndices_.empty())
+    {
+        index = freeIndices_.back();
+        freeIndices_.pop_back();
+    }
+    else
+    {
+        if ((int)slots_.size() == kMaxEntities) return 0;
+        index = (Uint32)slots_.size();
+        slots_.push_back(0);
+        generations_.push_back(1);
+    }
+
+    Entity entity = (generations_[index] << kIndexBits) | index;
+    slots_[index] = (Uint32)entities_.size();
+    entities_.push_back(entity);
+    x_.push_back(x);
+    y_.push_back(y);
+    vx_.push_back(vx);
+    vy_.push_back(vy);
+    sprites_.push_back(sprite);
+    colors_.push_back(color);
+    clips_.push_back(kNoClip);
+    clipTimes_.push_back(0.f);
+
+    return entity;
+}
+
+void EntityStore::SetAnimation(Entity entity, ClipId clip, float time)
+{
+    int slot = GetSlot(entity);
+    if (slot < 0) return;
+
+    clips_[slot]     = clip;
+    clipTimes_[slot] = time;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+    int slot = GetSlot(entity);
+    if (slot < 0) return;
+
+    // Fill the hole with the last entity.
+    int last = (int)entities_.size() - 1;
+    if (slot != last)
+    {
+        entities_[slot] = entities_[last];
+        x_[slot]        = x_[last];
+        y_[slot]        = y_[last];
+        vx_[slot]       = vx_[last];
+        vy_[slot]       = vy_[last];
+        sprites_[slot]  = sprites_[last];
+        colors_[slot]   = colors_[last];
+        clips_[slot]    = clips_[last];
+        clipTimes_[slot] = clipTimes_[last];
+        slots_[entities_[slot] & kIndexMask] = slot;
+    }
+    entities_.pop_back();
+    x_.pop_back();
+    y_.pop_back();
+    vx_.pop_back();
+    vy_.pop_back();
+    sprites_.pop_back();
+    colors_.pop_back();
+    clips_.pop_back();
+    clipTimes_.pop_back();
+
+    // Old handles to the index go stale.
+    Uint32 index = entity & kIndexMask;
+    generations_[index] = NextGeneration(generations_[index]);
+    freeIndices_.push_back(index);
+}
+
+void EntityStore::Clear()
+{
+    for (size_t i = 0; i < entities_.size(); ++i)
+    {
+        Uint32 index = entities_[i] & kIndexMask;
+        generations_[index] = NextGeneration(generations_[index]);
+        freeIndices_.push_back(index);
+    }
+
+    entities_.clear();
+    x_.clear();
+    y_.clear();
+    vx_.clear();
+    vy_.clear();
+    sprites_.clear();
+    colors_.clear();
+    clips_.clear();
+    clipTimes_.clear();
+}
+
+bool EntityStore::IsAlive(Entity entity) { return GetSlot(entity) >= 0; }
+
+int EntityStore::GetSlot(Entity entity)
+{
+    Uint32 index = entity & kIndexMask;
+    if (entity == 0 || index >= slots_.size()) return -1;
+    if (generations_[index] != entity >> kIndexBits) return -1;
+
+    // A freed index keeps its last slot; the generation already moved on.
+    return (int)slots_[index];
+}
+
+EntityView EntityStore::GetView()
+{
+    EntityView view;
+    SDL_zero(view);
+    view.count = (int)entities_.size();
+    if (view.count == 0) return view;
+
+    view.entities = &entities_[0];
+    view.x        = &x_[0];
+    view.y        = &y_[0];
+    view.vx       = &vx_[0];
+    view.vy       = &vy_[0];
+    view.sprites  = &sprites_[0];
+    view.colors   = &colors_[0];
+    view.clips    = &clips_[0];
+    view.clipTimes = &clipTimes_[0];
+    return view;
+}
+
+void EntityStore::Integrate(float seconds, float width, float height, JobSystem* jobs)
+{
+    IntegrateJob job;
+    job.view    = GetView();
+    job.seconds = seconds;
+    job.width   = width;
+    job.height  = height;
+
+    // Chunks big enough to amortize the scheduling.
+    if (jobs != NULL) jobs->ParallelFor(job.view.count, 16384, IntegrateRange, &job);
+    else              IntegrateRange(&job, 0, job.view.count);
+}
+
+void EntityStore::IntegrateRange(void* data, int begin, int end)
+{
+    const IntegrateJob& job = *static_cast<IntegrateJob*>(data);
+    float* x  = job.view.x;
+    float* y  = job.view.y;
+    float* vx = job.view.vx;
+    float* vy = job.view.vy;
+
+    // Branch free selects, so the compiler can vectorize the loop.
+    for (int i = begin; i < end; ++i)
+    {
+        float nx = x[i] + vx[i] * job.seconds;
+        float ny = y[i] + vy[i] * job.seconds;
+        bool  bx = nx < 0.f || nx > job.width;
+        bool  by = ny < 0.f || ny > job.height;
+        vx[i]    = bx ? -vx[i] : vx[i];
+        vy[i]    = by ? -vy[i] : vy[i];
+        // Clamped, so entities left outside by a shrinking area come back.
+        x[i]     = nx < 0.f ? 0.f : nx > job.width ? job.width : nx;
+        y[i]     = ny < 0.f ? 0.f : ny > job.height ? job.height : ny;
+    }
+}
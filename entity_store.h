@@ -0,0 +1,92 @@
+#ifndef ENTITY_STORE_H_
+#define ENTITY_STORE_H_
+
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "animation.h"
+#include "job_system.h"
+
+// A handle to an entity: its index in the low kIndexBits bits and the
+// generation of that index above them, so a stale handle never reaches the
+// entity that reused its index. 0 is never a live entity.
+typedef Uint32 Entity;
+
+// Packed pointers into the component arrays; slot i of each is the same
+// entity. Good until entities are created or destroyed.
+struct EntityView
+{
+    int        count;
+    Entity*    entities;
+    float*     x;
+    float*     y;
+    float*     vx;
+    float*     vy;
+    Uint8*     sprites;
+    SDL_Color* colors;
+    ClipId*    clips;
+    float*     clipTimes;
+};
+
+// The scene's objects as a sparse set over structure-of-arrays components.
+// Every entity has a position, a velocity, a sprite, a color and an
+// animation clip with its time, each held in its own packed array so systems
+// stream through only what they touch.
+// Destroying an entity moves the last one into its slot; the sparse array
+// maps an entity's index to its current slot.
+class EntityStore
+{
+public:
+    static const int kIndexBits   = 20;
+    static const int kMaxEntities = 1 << kIndexBits;
+
+    EntityStore();
+
+    // 0 when the store is full. Entities start out without a clip.
+    Entity Create(float x, float y, float vx, float vy, Uint8 sprite, SDL_Color color);
+    // Play the clip from the time on, or stop on the current sprite with
+    // kNoClip.
+    void   SetAnimation(Entity entity, ClipId clip, float time);
+    void   Destroy(Entity entity);
+    void   Clear();
+    bool   IsAlive(Entity entity);
+
+    int GetCount() { return (int)entities_.size(); }
+    // The entity's slot in the view, or -1 when it's gone.
+    int GetSlot(Entity entity);
+    EntityView GetView();
+
+    // Move every entity by its velocity over seconds, bouncing it off the
+    // edges of a width by height area. Split across the jobs when given.
+    void Integrate(float seconds, float width, float height, JobSystem* jobs);
+
+private:
+    struct IntegrateJob
+    {
+        EntityView view;
+        float      seconds;
+        float      width;
+        float      height;
+    };
+
+    static void IntegrateRange(void* data, int begin, int end);
+
+    // By index: the slot, and the generation of the current or next entity.
+    std::vector<Uint32>    slots_;
+    std::vector<Uint32>    generations_;
+    std::vector<Uint32>    freeIndices_;
+
+    // By slot.
+    std::vector<Entity>    entities_;
+    std::vector<float>     x_;
+    std::vector<float>     y_;
+    std::vector<float>     vx_;
+    std::vector<float>     vy_;
+    std::vector<Uint8>     sprites_;
+    std::vector<SDL_Color> colors_;
+    std::vector<ClipId>    clips_;
+    std::vector<float>     clipTimes_;
+};
+
+#endif  // ENTITY_STORE_H_
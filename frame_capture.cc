@@ -0,0 +1,322 @@
+#include "frame_capture.h"
+
+#include "logger.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FRAME_CAPTURE_X86 1
+#include <immintrin.h>
+#endif
+
+// The dump header, followed by the frames.
+static const char kDumpMagic[8] = {'S', 'D', 'L', 'C', 'A', 'P', '1', '\0'};
+
+// Frame, width, height and payload size.
+static const size_t kFrameHeaderSize = 4 * 4;
+
+// The longest run or literal of one RLE token.
+static const int kMaxRun = 128;
+
+static void PutLE32(std::vector<Uint8>& out, Uint32 value)
+{
+    for (int i = 0; i < 4; ++i) out.push_back((Uint8)(value >> (i * 8)));
+}
+
+static Uint32 GetLE32(const Uint8* in)
+{
+    return (Uint32)in[0] | ((Uint32)in[1] << 8) | ((Uint32)in[2] << 16) | ((Uint32)in[3] << 24);
+}
+
+// PackBits on whole pixels: a token below 0x80 is followed by token + 1
+// literal pixels, one above repeats the next pixel token - 0x7F times. The
+// XOR delta turns everything that didn't change into long zero runs.
+static void EncodeRle(const Uint32* in, int count, std::vector<Uint8>& out)
+{
+    int i = 0;
+    while (i < count)
+    {
+        int run = 1;
+        while (i + run < count && run < kMaxRun && in[i + run] == in[i]) ++run;
+        if (run > 1)
+        {
+            out.push_back((Uint8)(0x80 | (run - 1)));
+            PutLE32(out, in[i]);
+            i += run;
+            continue;
+        }
+
+        int start = i;
+        while (i < count && i - start < kMaxRun && (i + 1 >= count || in[i + 1] != in[i])) ++i;
+        out.push_back((Uint8)(i - start - 1));
+        for (int j = start; j < i; ++j) PutLE32(out, in[j]);
+    }
+}
+
+static bool DecodeRle(const Uint8* in, size_t size, Uint32* out, int count)
+{
+    const Uint8* end = in + size;
+    int          i   = 0;
+    while (in < end && i < count)
+    {
+        int token = *in++;
+        int run   = (token & 0x7F) + 1;
+        if (i + run > count) return false;
+
+        if (token & 0x80)
+        {
+            if (end - in < 4) return false;
+            Uint32 value = GetLE32(in);
+            in += 4;
+            for (int j = 0; j < run; ++j) out[i++] = value;
+        }
+        else
+        {
+            if (end - in < 4 * run) return false;
+            for (int j = 0; j < run; ++j, in += 4) out[i++] = GetLE32(in);
+        }
+    }
+
+    return in == end && i == count;
+}
+
+static int CountPixelDiffsScalar(const Uint32* a, const Uint32* b, int count, int tolerance)
+{
+    int diffs = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            int d = (int)((a[i] >> shift) & 0xFF) - (int)((b[i] >> shift) & 0xFF);
+            if (d > tolerance || -d > tolerance)
+            {
+                ++diffs;
+                break;
+            }
+        }
+    }
+
+    return diffs;
+}
+
+int CountPixelDiffs(const Uint32* a, const Uint32* b, int count, int tolerance)
+{
+    tolerance = SDL_max(0, SDL_min(tolerance, 255));
+
+#ifdef FRAME_CAPTURE_X86
+    // The pixels out of 4 that matched, by the movemask of the matches.
+    static const int kMatched[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i tol  = _mm_set1_epi8((char)tolerance);
+
+    int diffs = 0;
+    int i     = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        // The absolute difference per channel, minus the tolerance.
+        __m128i d    = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        __m128i over = _mm_cmpeq_epi32(_mm_subs_epu8(d, tol), zero);
+        diffs += 4 - kMatched[_mm_movemask_ps(_mm_castsi128_ps(over))];
+    }
+
+    return diffs + CountPixelDiffsScalar(a + i, b + i, count - i, tolerance);
+#else
+    return CountPixelDiffsScalar(a, b, count, tolerance);
+#endif
+}
+
+FrameCapture::FrameCapture()
+    : dump_(NULL), goldenFile_(NULL), interval_(0), tolerance_(0), captured_(0), compared_(0),
+      failed_(0)
+{
+}
+
+FrameCapture::~FrameCapture() { Close(); }
+
+bool FrameCapture::Open(const std::string& dumpPath, const std::string& goldenPath,
+                        int interval, int tolerance)
+{
+    Close();
+
+    if (!goldenPath.empty() && !OpenGolden(goldenPath)) return false;
+
+    if (!dumpPath.empty())
+    {
+        dump_ = SDL_RWFromFile(dumpPath.c_str(), "wb");
+        if (dump_ == NULL) return false;
+        SDL_RWwrite(dump_, kDumpMagic, 1, sizeof(kDumpMagic));
+    }
+
+    interval_  = SDL_max(interval, 1);
+    tolerance_ = tolerance;
+    return true;
+}
+
+void FrameCapture::Close()
+{
+    if (dump_ != NULL) SDL_RWclose(dump_);
+    dump_ = NULL;
+
+    previous_.clear();
+    CloseGolden();
+    goldenPath_.clear();
+    interval_ = 0;
+}
+
+void FrameCapture::Capture(SDL_Renderer* renderer, SDL_Surface* surface, unsigned frame)
+{
+    if (interval_ == 0 || frame % interval_ != 0) return;
+
+    int width, height;
+    if (surface != NULL)
+    {
+        width  = surface->w;
+        height = surface->h;
+    }
+    else if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) return;
+
+    current_.frame  = frame;
+    current_.width  = width;
+    current_.height = height;
+    current_.pixels.resize((size_t)width * height);
+    if (current_.pixels.empty()) return;
+
+    int result;
+    if (surface != NULL)
+        result = SDL_ConvertPixels(width, height, surface->format->format, surface->pixels,
+                                   surface->pitch, SDL_PIXELFORMAT_ARGB8888,
+                                   &current_.pixels[0], width * 4);
+    else
+        result = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888,
+                                      &current_.pixels[0], width * 4);
+    if (result != 0)
+    {
+        LogError("Unable to read back frame {}: {}", frame, SDL_GetError());
+        return;
+    }
+
+    // The window's alpha means nothing.
+    for (size_t i = 0; i < current_.pixels.size(); ++i) current_.pixels[i] |= 0xFF000000;
+
+    ++captured_;
+    if (dump_ != NULL) Write(current_);
+    if (!goldenPath_.empty()) Compare(current_);
+}
+
+void FrameCapture::Write(const Frame& frame)
+{
+    // Delta against the previous frame, or against black after a resize.
+    size_t count = frame.pixels.size();
+    if (previous_.size() != count) previous_.assign(count, 0);
+    delta_.resize(count);
+    for (size_t i = 0; i < count; ++i) delta_[i] = frame.pixels[i] ^ previous_[i];
+    previous_ = frame.pixels;
+
+    encoded_.clear();
+    EncodeRle(&delta_[0], (int)count, encoded_);
+
+    std::vector<Uint8> header;
+    PutLE32(header, frame.frame);
+    PutLE32(header, (Uint32)frame.width);
+    PutLE32(header, (Uint32)frame.height);
+    PutLE32(header, (Uint32)encoded_.size());
+    SDL_RWwrite(dump_, &header[0], 1, header.size());
+    SDL_RWwrite(dump_, &encoded_[0], 1, encoded_.size());
+}
+
+bool FrameCapture::OpenGolden(const std::string& path)
+{
+    goldenFile_ = SDL_RWFromFile(path.c_str(), "rb");
+    if (goldenFile_ == NULL) return false;
+
+    char magic[sizeof(kDumpMagic)];
+    if (SDL_RWread(goldenFile_, magic, 1, sizeof(magic)) != sizeof(magic) ||
+        SDL_memcmp(magic, kDumpMagic, sizeof(kDumpMagic)) != 0)
+    {
+        CloseGolden();
+        SDL_SetError("%s is not a frame dump", path.c_str());
+        return false;
+    }
+
+    goldenPath_ = path;
+    return true;
+}
+
+bool FrameCapture::ReadGolden()
+{
+    Uint8  header[kFrameHeaderSize];
+    size_t read = SDL_RWread(goldenFile_, header, 1, kFrameHeaderSize);
+    if (read == 0) return false;
+    if (read != kFrameHeaderSize) return GoldenCorrupt();
+
+    unsigned frame  = GetLE32(header);
+    int      width  = (int)GetLE32(header + 4);
+    int      height = (int)GetLE32(header + 8);
+    size_t   size   = GetLE32(header + 12);
+    size_t   count  = (size_t)width * height;
+    if (count == 0) return GoldenCorrupt();
+
+    goldenEncoded_.resize(size);
+    if (SDL_RWread(goldenFile_, goldenEncoded_.data(), 1, size) != size) return GoldenCorrupt();
+
+    goldenDelta_.resize(count);
+    if (!DecodeRle(goldenEncoded_.data(), size, &goldenDelta_[0], (int)count))
+        return GoldenCorrupt();
+
+    // Delta against the frame before, or against black after a resize.
+    if (golden_.pixels.size() != count) golden_.pixels.assign(count, 0);
+    for (size_t i = 0; i < count; ++i) golden_.pixels[i] ^= goldenDelta_[i];
+    golden_.frame  = frame;
+    golden_.width  = width;
+    golden_.height = height;
+    return true;
+}
+
+bool FrameCapture::GoldenCorrupt()
+{
+    // The frames from here on have nothing to compare with, so they fail.
+    LogError("{} is corrupt at byte {}", goldenPath_, SDL_RWtell(goldenFile_));
+    return false;
+}
+
+void FrameCapture::CloseGolden()
+{
+    if (goldenFile_ != NULL) SDL_RWclose(goldenFile_);
+    goldenFile_ = NULL;
+
+    golden_.pixels.clear();
+    goldenDelta_.clear();
+    goldenEncoded_.clear();
+}
+
+void FrameCapture::Compare(const Frame& frame)
+{
+    // Both dumps are in frame order, so the golden one only ever reads ahead.
+    while (goldenFile_ != NULL && (golden_.pixels.empty() || golden_.frame < frame.frame))
+    {
+        if (!ReadGolden()) CloseGolden();
+    }
+
+    // A golden dump that ended early, or was taken at another interval,
+    // must not pass for lack of comparisons.
+    if (golden_.pixels.empty() || golden_.frame != frame.frame)
+    {
+        ++failed_;
+        LogError("Frame {} has no golden frame to compare with", frame.frame);
+        return;
+    }
+
+    const Frame& golden = golden_;
+    ++compared_;
+
+    int diffs = (int)frame.pixels.size();
+    if (golden.width == frame.width && golden.height == frame.height)
+        diffs = CountPixelDiffs(&frame.pixels[0], &golden.pixels[0], diffs, tolerance_);
+
+    if (diffs > 0)
+    {
+        ++failed_;
+        LogError("Frame {} differs from the golden image in {} pixels", frame.frame, diffs);
+    }
+}
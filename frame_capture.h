@@ -0,0 +1,82 @@
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+// Reads back every Nth finished frame, writes it to a compressed dump and
+// compares it against the same frame of a golden dump. A dump is a header
+// followed by one record per frame: the frame index, width, height and
+// payload size (LE32 each), then the ARGB8888 pixels XORed with the previous
+// frame of the dump and run-length encoded.
+class FrameCapture
+{
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Either path may be empty. A pixel differs from the golden one when any
+    // channel is more than tolerance apart.
+    bool Open(const std::string& dumpPath, const std::string& goldenPath, int interval,
+              int tolerance);
+    void Close();
+
+    bool IsOpen() { return interval_ > 0; }
+
+    // Capture the frame if it's due. Call on the render thread once the frame
+    // is drawn but before it's presented; surface is the software frame, or
+    // NULL to read the renderer back.
+    void Capture(SDL_Renderer* renderer, SDL_Surface* surface, unsigned frame);
+
+    int GetCapturedFrames() { return captured_; }
+    int GetComparedFrames() { return compared_; }
+    int GetFailedFrames() { return failed_; }
+
+private:
+    struct Frame
+    {
+        unsigned            frame;
+        int                 width;
+        int                 height;
+        std::vector<Uint32> pixels;
+    };
+
+    bool OpenGolden(const std::string& path);
+    // Decode the next frame of the golden dump into golden_. False at its
+    // end, or when it's corrupt.
+    bool ReadGolden();
+    // Log where the golden dump went wrong; false.
+    bool GoldenCorrupt();
+    void CloseGolden();
+    void Write(const Frame& frame);
+    void Compare(const Frame& frame);
+
+    SDL_RWops*          dump_;
+    // The last frame written, the base of the next delta.
+    std::vector<Uint32> previous_;
+    std::vector<Uint32> delta_;
+    std::vector<Uint8>  encoded_;
+    Frame               current_;
+
+    // The golden dump stays open and is decoded a frame at a time as the
+    // capture catches up; golden_ is the last frame read, the base of the
+    // next delta.
+    SDL_RWops*          goldenFile_;
+    std::string         goldenPath_;
+    Frame               golden_;
+    std::vector<Uint32> goldenDelta_;
+    std::vector<Uint8>  goldenEncoded_;
+
+    int                 interval_;
+    int                 tolerance_;
+    int                 captured_;
+    int                 compared_;
+    int                 failed_;
+};
+
+// The number of pixels with any channel more than tolerance apart.
+int CountPixelDiffs(const Uint32* a, const Uint32* b, int count, int tolerance);
+
+#endif  // FRAME_CAPTURE_H_
@@ -0,0 +1,154 @@
+#include "frame_packet.h"
+
+void FramePacket::Reset(unsigned frameIndex)
+{
+    frame      = frameIndex;
+    inputTime  = 0;
+    eventCount = 0;
+    showHud    = false;
+    width      = 0;
+    height     = 0;
+    viewScale  = 1.f;
+    viewAngle  = 0.f;
+    clearColor.r = clearColor.g = clearColor.b = clearColor.a = 0xFF;
+    draws.clear();
+    texts.clear();
+    sprites.x.clear();
+    sprites.y.clear();
+    sprites.ids.clear();
+    sprites.colors.clear();
+    chunks.clear();
+}
+
+void FramePacket::AddText(const std::string& text, SDL_Color color, int x, int y)
+{
+    TextRequest request;
+    request.text  = text;
+    request.color = color;
+    texts.push_back(request);
+
+    DrawItem item;
+    SDL_zero(item);
+    item.type   = DrawItem::kText;
+    item.text   = (int)texts.size() - 1;
+    item.rect.x = x;
+    item.rect.y = y;
+    item.rect.w = 0;
+    item.rect.h = 0;
+    item.color  = color;
+    item.layer  = -1;
+    draws.push_back(item);
+}
+
+void FramePacket::AddFillRect(const SDL_Rect& rect, SDL_Color color)
+{
+    DrawItem item;
+    SDL_zero(item);
+    item.type  = DrawItem::kFillRect;
+    item.text  = -1;
+    item.rect  = rect;
+    item.color = color;
+    item.layer = -1;
+    draws.push_back(item);
+}
+
+void FramePacket::AddTileChunk(const TileChunk& chunk, float x, float y)
+{
+    DrawItem item;
+    SDL_zero(item);
+    item.type    = DrawItem::kTileChunk;
+    item.text    = -1;
+    item.layer   = -1;
+    item.first   = (int)chunks.size();
+    item.point.x = x;
+    item.point.y = y;
+    draws.push_back(item);
+
+    // A kilobyte or so; the render thread can't read the map itself.
+    chunks.push_back(chunk);
+}
+
+void FramePacket::AddSprites(const float* x, const float* y, const Uint8* ids,
+                             const SDL_Color* colors, int count)
+{
+    if (count <= 0) return;
+
+    DrawItem item;
+    SDL_zero(item);
+    item.type  = DrawItem::kSprites;
+    item.text  = -1;
+    item.layer = -1;
+    item.first = (int)sprites.x.size();
+    item.count = count;
+    draws.push_back(item);
+
+    // Whole arrays at a time; the vectors keep their memory across frames.
+    sprites.x.insert(sprites.x.end(), x, x + count);
+    sprites.y.insert(sprites.y.end(), y, y + count);
+    sprites.ids.insert(sprites.ids.end(), ids, ids + count);
+    sprites.colors.insert(sprites.colors.end(), colors, colors + count);
+}
+
+void FramePacket::AddSprites(const float* x, const float* y, const Uint8* ids,
+                             const SDL_Color* colors, const int* slots, int count)
+{
+    if (count <= 0) return;
+
+    DrawItem item;
+    SDL_zero(item);
+    item.type  = DrawItem::kSprites;
+    item.text  = -1;
+    item.layer = -1;
+    item.first = (int)sprites.x.size();
+    item.count = count;
+    draws.push_back(item);
+
+    size_t first = sprites.x.size();
+    sprites.x.resize(first + count);
+    sprites.y.resize(first + count);
+    sprites.ids.resize(first + count);
+    sprites.colors.resize(first + count);
+    for (int i = 0; i < count; ++i)
+    {
+        int slot                  = slots[i];
+        sprites.x[first + i]      = x[slot];
+        sprites.y[first + i]      = y[slot];
+        sprites.ids[first + i]    = ids[slot];
+        sprites.colors[first + i] = colors[slot];
+    }
+}
+
+int FramePacket::BeginLayer(int layer, unsigned version, const SDL_Rect& bounds)
+{
+    DrawItem item;
+    SDL_zero(item);
+    item.type    = DrawItem::kLayer;
+    item.text    = -1;
+    item.rect    = bounds;
+    item.layer   = layer;
+    item.version = version;
+    draws.push_back(item);
+
+    return (int)draws.size() - 1;
+}
+
+void FramePacket::EndLayer(int begin) { draws[begin].count = (int)draws.size() - begin - 1; }
+
+FrameQueue::FrameQueue() : back_(0), front_(1)
+{
+    SDL_AtomicSet(&middle_, 2);
+}
+
+void FrameQueue::Publish()
+{
+    // The exchange also orders the packet writes before the swap.
+    back_ = SDL_AtomicSet(&middle_, back_ | kFresh) & ~kFresh;
+}
+
+FramePacket* FrameQueue::Acquire()
+{
+    if ((SDL_AtomicGet(&middle_) & kFresh) == 0) return NULL;
+
+    front_ = SDL_AtomicSet(&middle_, front_) & ~kFresh;
+    return &packets_[front_];
+}
@@ -0,0 +1,145 @@
+#ifndef FRAME_PACKET_H_
+#define FRAME_PACKET_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+// A line of text for the render thread to rasterize.
+struct TextRequest
+{
+    std::string text;
+    SDL_Color   color;
+};
+
+// One draw of a frame.
+struct DrawItem
+{
+    enum Type
+    {
+        kText,
+        kFillRect,
+        kLayer,
+        kSprites,
+        kTileChunk
+    };
+
+    Type       type;
+    // The text request drawn, for kText.
+    int        text;
+    // The destination; text only uses the position. The bounds of a layer.
+    SDL_Rect   rect;
+    SDL_Color  color;
+
+    // For kLayer, the layer id, the version of its content and how many of
+    // the following draws make up that content. For kSprites, the first
+    // sprite of the packet's batch and how many are drawn. For kTileChunk,
+    // the packet's chunk drawn with its top left at the point.
+    int        layer;
+    unsigned   version;
+    int        count;
+    int        first;
+    SDL_FPoint point;
+};
+
+// The sprites of a frame as structure-of-arrays, copied in bulk from the
+// entity store. A position is the center of the sprite on screen.
+struct SpriteBatch
+{
+    std::vector<float>     x;
+    std::vector<float>     y;
+    // Which sprite of the sheet.
+    std::vector<Uint8>     ids;
+    std::vector<SDL_Color> colors;
+};
+
+// A square of a tilemap's tiles, 0 being none, and a version that changes
+// whenever they do. Chunks are prerendered and cached as a whole.
+struct TileChunk
+{
+    // The edge of a chunk in tiles, and of a tile in pixels.
+    static const int kTiles    = 32;
+    static const int kTileSize = 16;
+    static const int kSize     = kTiles * kTileSize;
+
+    // Where in the map, in chunks.
+    int      x;
+    int      y;
+    unsigned version;
+    Uint8    tiles[kTiles * kTiles];
+};
+
+// Everything the render thread needs to draw one frame. The main thread
+// fills it in and never touches it again once submitted.
+struct FramePacket
+{
+    unsigned                 frame;
+    // When the oldest input shown by this frame happened, in
+    // SDL_GetPerformanceCounter() units; 0 without input.
+    Uint64                   inputTime;
+    // The events drained for this frame, and whether to draw the HUD.
+    int                      eventCount;
+    bool                     showHud;
+    // The window's size in logical pixels; the renderer scales the frame up
+    // to the output's pixel density.
+    int                      width;
+    int                      height;
+    // The camera's zoom and clockwise rotation in degrees, which the sprites
+    // and tile chunks are drawn with; their positions are already on screen.
+    float                    viewScale;
+    float                    viewAngle;
+    SDL_Color                clearColor;
+    std::vector<DrawItem>    draws;
+    std::vector<TextRequest> texts;
+    SpriteBatch              sprites;
+    std::vector<TileChunk>   chunks;
+
+    // Empty the packet, keeping its memory for the next frame.
+    void Reset(unsigned frameIndex);
+
+    void AddText(const std::string& text, SDL_Color color, int x, int y);
+    void AddFillRect(const SDL_Rect& rect, SDL_Color color);
+    // Not inside layers.
+    void AddTileChunk(const TileChunk& chunk, float x, float y);
+    void AddSprites(const float* x, const float* y, const Uint8* ids, const SDL_Color* colors,
+                    int count);
+    // The same for only the sprites at the slots given, such as the ones
+    // left after culling.
+    void AddSprites(const float* x, const float* y, const Uint8* ids, const SDL_Color* colors,
+                    const int* slots, int count);
+
+    // The draws added between these make up a cached layer, rendered again
+    // only when the version changes or one of its texts does. Returns the
+    // index of the layer draw for EndLayer().
+    int  BeginLayer(int layer, unsigned version, const SDL_Rect& bounds);
+    void EndLayer(int begin);
+};
+
+// A lock-free triple buffer of frame packets between one producer and one
+// consumer. The producer fills the back packet and swaps it with the middle
+// one, the consumer swaps the middle packet for its front one whenever a
+// fresh one is there. Neither side ever waits on the other.
+class FrameQueue
+{
+public:
+    FrameQueue();
+
+    // Producer side.
+    FramePacket* GetBack() { return &packets_[back_]; }
+    void Publish();
+
+    // Consumer side, NULL when nothing new was published.
+    FramePacket* Acquire();
+
+private:
+    // Set in middle_ while the middle packet hasn't been consumed.
+    static const int kFresh = 4;
+
+    FramePacket  packets_[3];
+    int          back_;
+    int          front_;
+    SDL_atomic_t middle_;
+};
+
+#endif  // FRAME_PACKET_H_
@@ -0,0 +1,159 @@
+#include "framebuffer.h"
+
+#include "render_stats.h"
+
+Framebuffer::Framebuffer()
+    : surface_(NULL), texture_(NULL), jobs_(NULL), tilesX_(0), tilesY_(0), clearColor_(0) {}
+
+Framebuffer::~Framebuffer() { Free(); }
+
+bool Framebuffer::Create(SDL_Renderer* renderer, int width, int height, JobSystem* jobs)
+{
+    Free();
+
+    jobs_    = jobs;
+    surface_ = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface_ == NULL) return false;
+
+    texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                 SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (texture_ == NULL) return false;
+    SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_NONE);
+
+    tilesX_ = (width + kTileSize - 1) / kTileSize;
+    tilesY_ = (height + kTileSize - 1) / kTileSize;
+    bins_.resize(tilesX_ * tilesY_);
+
+    return true;
+}
+
+void Framebuffer::Free()
+{
+    if (texture_ != NULL) SDL_DestroyTexture(texture_);
+    if (surface_ != NULL) SDL_FreeSurface(surface_);
+
+    texture_ = NULL;
+    surface_ = NULL;
+    ops_.clear();
+    bins_.clear();
+}
+
+void Framebuffer::Clear(Uint8 r, Uint8 g, Uint8 b)
+{
+    clearColor_ = SDL_MapRGBA(surface_->format, r, g, b, 0xFF);
+
+    // Keep the capacity around for the next frame.
+    ops_.clear();
+    for (size_t i = 0; i < bins_.size(); ++i) bins_[i].clear();
+}
+
+void Framebuffer::Blit(const SDL_Surface* src, const SDL_Rect* srcRect, int x, int y)
+{
+    BlitOp op;
+    op.dst   = surface_;
+    op.src   = src;
+    op.x     = x;
+    op.y     = y;
+    op.color = 0;
+    if (srcRect != NULL) op.srcRect = *srcRect;
+    else
+    {
+        op.srcRect.x = 0;
+        op.srcRect.y = 0;
+        op.srcRect.w = src->w;
+        op.srcRect.h = src->h;
+    }
+
+    Queue(op);
+}
+
+void Framebuffer::BlitTinted(const SDL_Surface* src, const SDL_Rect& srcRect, int x, int y,
+                             SDL_Color color)
+{
+    // A transparent tint leaves nothing to draw, and 0 means no tint.
+    if (color.a == 0) return;
+
+    BlitOp op;
+    op.dst     = surface_;
+    op.src     = src;
+    op.srcRect = srcRect;
+    op.x       = x;
+    op.y       = y;
+    op.color   = PremultiplyColor(color);
+
+    Queue(op);
+}
+
+void Framebuffer::FillRect(const SDL_Rect& rect, SDL_Color color)
+{
+    BlitOp op;
+    op.dst       = surface_;
+    op.src       = NULL;
+    op.srcRect.x = 0;
+    op.srcRect.y = 0;
+    op.srcRect.w = rect.w;
+    op.srcRect.h = rect.h;
+    op.x         = rect.x;
+    op.y         = rect.y;
+    op.color     = PremultiplyColor(color);
+
+    Queue(op);
+}
+
+void Framebuffer::Queue(BlitOp& op)
+{
+    if (!ClipBlit(op, NULL)) return;
+
+    // Bin the blit into every tile it overlaps.
+    int index = (int)ops_.size();
+    ops_.push_back(op);
+
+    int x0 = op.x / kTileSize;
+    int y0 = op.y / kTileSize;
+    int x1 = (op.x + op.srcRect.w - 1) / kTileSize;
+    int y1 = (op.y + op.srcRect.h - 1) / kTileSize;
+    for (int ty = y0; ty <= y1; ++ty)
+    {
+        for (int tx = x0; tx <= x1; ++tx) bins_[ty * tilesX_ + tx].push_back(index);
+    }
+}
+
+void Framebuffer::Present(SDL_Renderer* renderer)
+{
+    int tiles = tilesX_ * tilesY_;
+    if (jobs_ != NULL) jobs_->ParallelFor(tiles, 1, RasterizeTiles, this);
+    else               RasterizeTiles(this, 0, tiles);
+
+    SDL_UpdateTexture(texture_, NULL, surface_->pixels, surface_->pitch);
+    SDL_RenderCopy(renderer, texture_, NULL, NULL);
+    CountUpload(surface_->h * surface_->pitch);
+    CountDrawCalls(1);
+}
+
+void Framebuffer::RasterizeTiles(void* data, int begin, int end)
+{
+    Framebuffer* framebuffer = static_cast<Framebuffer*>(data);
+    for (int tile = begin; tile < end; ++tile) framebuffer->RasterizeTile(tile);
+}
+
+void Framebuffer::RasterizeTile(int tile)
+{
+    SDL_Rect bounds = {(tile % tilesX_) * kTileSize, (tile / tilesX_) * kTileSize,
+                       kTileSize, kTileSize};
+    SDL_Rect full   = {0, 0, surface_->w, surface_->h};
+    SDL_IntersectRect(&bounds, &full, &bounds);
+
+    // Every tile clears and blends only its own pixels, so no locking.
+    for (int y = bounds.y; y < bounds.y + bounds.h; ++y)
+    {
+        Uint32* row = (Uint32*)((Uint8*)surface_->pixels + y * surface_->pitch) + bounds.x;
+        for (int x = 0; x < bounds.w; ++x) row[x] = clearColor_;
+    }
+
+    const std::vector<int>& bin = bins_[tile];
+    for (size_t i = 0; i < bin.size(); ++i)
+    {
+        BlitOp op = ops_[bin[i]];
+        if (ClipBlit(op, &bounds)) BlitRows(op, 0, op.srcRect.h);
+    }
+}
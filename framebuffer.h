@@ -0,0 +1,65 @@
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "blitter.h"
+#include "job_system.h"
+
+// The CPU side frame used when SDL falls back to its software renderer.
+// Blits are recorded and binned into screen tiles; at Present() the tiles
+// are cleared and composited in parallel with the SIMD blitter, then the
+// frame is uploaded with a single SDL_UpdateTexture.
+class Framebuffer
+{
+public:
+    // The edge of a square screen tile in pixels.
+    static const int kTileSize = 64;
+
+    Framebuffer();
+    ~Framebuffer();
+
+    bool Create(SDL_Renderer* renderer, int width, int height, JobSystem* jobs = NULL);
+    void Free();
+
+    // Start a new frame cleared to the color.
+    void Clear(Uint8 r, Uint8 g, Uint8 b);
+
+    // Queue a premultiplied ARGB8888 surface at x, y. The surface has to
+    // stay alive until Present().
+    void Blit(const SDL_Surface* src, const SDL_Rect* srcRect, int x, int y);
+    // The same, with the surface's pixels multiplied by the color.
+    void BlitTinted(const SDL_Surface* src, const SDL_Rect& srcRect, int x, int y,
+                    SDL_Color color);
+
+    // Queue a blended rectangle fill.
+    void FillRect(const SDL_Rect& rect, SDL_Color color);
+
+    // Rasterize the queued blits, upload the frame and copy it to the
+    // renderer's target.
+    void Present(SDL_Renderer* renderer);
+
+    SDL_Surface* GetSurface() { return surface_; }
+
+private:
+    void Queue(BlitOp& op);
+    static void RasterizeTiles(void* data, int begin, int end);
+    void RasterizeTile(int tile);
+
+    SDL_Surface* surface_;
+    SDL_Texture* texture_;
+    JobSystem*   jobs_;
+
+    int          tilesX_;
+    int          tilesY_;
+    Uint32       clearColor_;
+
+    // The blits of the frame, and the blit indices touching each tile in
+    // submission order.
+    std::vector<BlitOp>           ops_;
+    std::vector<std::vector<int> > bins_;
+};
+
+#endif  // FRAMEBUFFER_H_
@@ -0,0 +1,225 @@
+#include "hud.h"
+
+#include <algorithm>
+
+static const char* const kGlyphText[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "."};
+
+static const char* const kLabelText[] = {"p50 ",     "  p95 ", "  p99 ",   " ms",
+                                         "draw ",    "  tex ",  "  upload ", " KB",
+                                         "  alloc ", "  conv ", "events ",  "  hud "};
+
+// The atlas is rasterized at the font size and drawn at half of it.
+static const int kScaleShift = 1;
+
+// The graph, one bar per frame, and the frame time at its top.
+static const int kBarWidth    = 2;
+static const int kGraphHeight = 60;
+static const int kGraphTop    = 33333;
+// The frame time above which a bar shows up red.
+static const int kSlowFrame   = 16667;
+
+static const int kMargin = 10;
+
+Hud::Hud()
+    : atlas_(NULL), lineHeight_(0), head_(0), count_(0), events_(0), cost_(0)
+{
+    SDL_zero(glyphs_);
+    SDL_zero(labels_);
+    SDL_zero(stats_);
+}
+
+Hud::~Hud() { Free(); }
+
+bool Hud::Create(SDL_Renderer* renderer, TextureFormat& format, TextCache& texts)
+{
+    Free();
+
+    const int    kPieces = kGlyphCount + kLabelCount;
+    SDL_Surface* pieces[kPieces];
+    SDL_Color    white   = {255, 255, 255, 255};
+    int          width   = 0;
+    int          height  = 0;
+    bool         ok      = true;
+
+    for (int i = 0; i < kPieces; ++i)
+    {
+        TextRequest request;
+        request.text  = i < kGlyphCount ? kGlyphText[i] : kLabelText[i - kGlyphCount];
+        request.color = white;
+        pieces[i]     = texts.Acquire(request, texts.GetFontSize());
+        if (pieces[i] == NULL) ok = false;
+        else
+        {
+            width += pieces[i]->w;
+            height = SDL_max(height, pieces[i]->h);
+        }
+    }
+
+    // Lay the pieces out in a row.
+    SDL_Surface* atlas = NULL;
+    if (ok) atlas = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas != NULL)
+    {
+        SDL_Rect rect = {0, 0, 0, 0};
+        for (int i = 0; i < kPieces; ++i)
+        {
+            rect.w = pieces[i]->w;
+            rect.h = pieces[i]->h;
+            // The pieces are shared, copy rather than blit them.
+            for (int y = 0; y < rect.h; ++y)
+                SDL_memcpy((Uint8*)atlas->pixels + y * atlas->pitch + rect.x * 4,
+                           (Uint8*)pieces[i]->pixels + y * pieces[i]->pitch, rect.w * 4);
+
+            if (i < kGlyphCount) glyphs_[i] = rect;
+            else                 labels_[i - kGlyphCount] = rect;
+            rect.x += rect.w;
+        }
+
+        atlas_ = format.CreateTexture(renderer, atlas);
+        SDL_FreeSurface(atlas);
+    }
+
+    for (int i = 0; i < kPieces; ++i) texts.Release(pieces[i]);
+
+    lineHeight_ = height >> kScaleShift;
+    return atlas_ != NULL;
+}
+
+void Hud::Free()
+{
+    if (atlas_ != NULL) SDL_DestroyTexture(atlas_);
+    atlas_ = NULL;
+}
+
+void Hud::AddFrame(int frameTime, const RenderStats& stats, int events)
+{
+    history_[(head_ + count_) % kHistory] = frameTime;
+    if (count_ < kHistory) ++count_;
+    else                   head_ = (head_ + 1) % kHistory;
+
+    stats_  = stats;
+    events_ = events;
+}
+
+int Hud::Percentile(int count, int percent)
+{
+    int* nth = sorted_ + (count - 1) * percent / 100;
+    std::nth_element(sorted_, nth, sorted_ + count);
+    return *nth;
+}
+
+int Hud::DrawPiece(SDL_Renderer* renderer, const SDL_Rect& piece, int x, int y)
+{
+    SDL_Rect dest = {x, y, piece.w >> kScaleShift, piece.h >> kScaleShift};
+    SDL_RenderCopy(renderer, atlas_, &piece, &dest);
+    return x + dest.w;
+}
+
+int Hud::DrawNumber(SDL_Renderer* renderer, int value, int decimals, int x, int y)
+{
+    // The digits, least significant first.
+    int digits[12];
+    int count = 0;
+    value     = SDL_max(value, 0);
+    do
+    {
+        digits[count++] = value % 10;
+        value /= 10;
+    } while (value != 0 || count <= decimals);
+
+    for (int i = count - 1; i >= 0; --i)
+    {
+        x = DrawPiece(renderer, glyphs_[digits[i]], x, y);
+        if (i == decimals && i != 0) x = DrawPiece(renderer, glyphs_[kGlyphCount - 1], x, y);
+    }
+
+    return x;
+}
+
+void Hud::Draw(SDL_Renderer* renderer)
+{
+    if (atlas_ == NULL || count_ == 0) return;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int outputHeight;
+    // In logical pixels, when the renderer scales them to the output.
+    SDL_RenderGetLogicalSize(renderer, NULL, &outputHeight);
+    if (outputHeight == 0) SDL_GetRendererOutputSize(renderer, NULL, &outputHeight);
+
+    int width  = kHistory * kBarWidth;
+    int height = kGraphHeight + 3 * lineHeight_ + kMargin;
+    int left   = kMargin;
+    int top    = outputHeight - height - kMargin;
+    int bottom = top + kGraphHeight;
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_Rect panel = {left - kMargin / 2, top - kMargin / 2, width + 2 * kMargin, height};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &panel);
+
+    // One bar per frame, oldest on the left; the fast bars fill bars_ from
+    // the front and the slow ones from the back, one batch each.
+    int fast = 0;
+    int slow = kHistory;
+    for (int i = 0; i < count_; ++i)
+    {
+        int      time      = history_[(head_ + i) % kHistory];
+        int      barHeight = SDL_max(1, SDL_min(time, kGraphTop) * kGraphHeight / kGraphTop);
+        SDL_Rect bar       = {left + i * kBarWidth, bottom - barHeight, kBarWidth, barHeight};
+        bars_[time > kSlowFrame ? --slow : fast++] = bar;
+        sorted_[i] = time;
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0x40, 0xD0, 0x60, 255);
+    SDL_RenderFillRects(renderer, bars_, fast);
+    SDL_SetRenderDrawColor(renderer, 0xE0, 0x40, 0x30, 255);
+    SDL_RenderFillRects(renderer, bars_ + slow, kHistory - slow);
+
+    static const int   kPercents[3] = {50, 95, 99};
+    static const Uint8 kLineColors[3][3] = {
+        {0xFF, 0xFF, 0xFF}, {0xFF, 0xD0, 0x40}, {0xFF, 0x60, 0x60}};
+    static const Label kLineLabels[3] = {kLabelP50, kLabelP95, kLabelP99};
+
+    // The percentile lines and their values, in ms.
+    int x = left;
+    int y = bottom + kMargin / 2;
+    for (int i = 0; i < 3; ++i)
+    {
+        int      time  = Percentile(count_, kPercents[i]);
+        int      lineY = bottom - SDL_min(time, kGraphTop) * kGraphHeight / kGraphTop;
+        SDL_Rect line  = {left, lineY, width, 1};
+        SDL_SetRenderDrawColor(renderer, kLineColors[i][0], kLineColors[i][1], kLineColors[i][2],
+                               255);
+        SDL_RenderFillRect(renderer, &line);
+
+        x = DrawPiece(renderer, labels_[kLineLabels[i]], x, y);
+        x = DrawNumber(renderer, time / 10, 2, x, y);
+    }
+    DrawPiece(renderer, labels_[kLabelMs], x, y);
+
+    // The counters of the last frame.
+    x = left;
+    y += lineHeight_;
+    x = DrawPiece(renderer, labels_[kLabelDraws], x, y);
+    x = DrawNumber(renderer, stats_.drawCalls, 0, x, y);
+    x = DrawPiece(renderer, labels_[kLabelTextures], x, y);
+    x = DrawNumber(renderer, stats_.textureCreations, 0, x, y);
+    x = DrawPiece(renderer, labels_[kLabelUpload], x, y);
+    x = DrawNumber(renderer, stats_.bytesUploaded / 1024, 0, x, y);
+    x = DrawPiece(renderer, labels_[kLabelKb], x, y);
+    x = DrawPiece(renderer, labels_[kLabelAllocs], x, y);
+    x = DrawNumber(renderer, stats_.allocations, 0, x, y);
+    x = DrawPiece(renderer, labels_[kLabelConversions], x, y);
+    DrawNumber(renderer, stats_.conversions, 0, x, y);
+
+    x = left;
+    y += lineHeight_;
+    x = DrawPiece(renderer, labels_[kLabelEvents], x, y);
+    x = DrawNumber(renderer, events_, 0, x, y);
+    x = DrawPiece(renderer, labels_[kLabelHud], x, y);
+    x = DrawNumber(renderer, cost_ / 10, 2, x, y);
+    DrawPiece(renderer, labels_[kLabelMs], x, y);
+
+    cost_ = (int)((SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency());
+}
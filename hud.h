@@ -0,0 +1,77 @@
+#ifndef HUD_H_
+#define HUD_H_
+
+#include "SDL2/SDL.h"
+
+#include "render_stats.h"
+#include "text_cache.h"
+#include "texture_format.h"
+
+// The performance overlay: a scrolling frame-time graph with its 50th, 95th
+// and 99th percentile lines, and the render counters of the last frame. The
+// text is put together from a glyph atlas built once, so drawing it neither
+// allocates nor rasterizes anything.
+class Hud
+{
+public:
+    // The frames shown by the graph.
+    static const int kHistory = 120;
+
+    Hud();
+    ~Hud();
+
+    // Build the glyph atlas; again whenever the font changed.
+    bool Create(SDL_Renderer* renderer, TextureFormat& format, TextCache& texts);
+    void Free();
+
+    // Record a presented frame, its time in microseconds.
+    void AddFrame(int frameTime, const RenderStats& stats, int events);
+
+    // Draw in the bottom left corner of the output.
+    void Draw(SDL_Renderer* renderer);
+
+private:
+    enum Label
+    {
+        kLabelP50,
+        kLabelP95,
+        kLabelP99,
+        kLabelMs,
+        kLabelDraws,
+        kLabelTextures,
+        kLabelUpload,
+        kLabelKb,
+        kLabelAllocs,
+        kLabelConversions,
+        kLabelEvents,
+        kLabelHud,
+        kLabelCount
+    };
+
+    // The digits and the decimal point.
+    static const int kGlyphCount = 11;
+
+    int DrawPiece(SDL_Renderer* renderer, const SDL_Rect& piece, int x, int y);
+    // Draw value / 10^decimals; returns the x after the last glyph.
+    int DrawNumber(SDL_Renderer* renderer, int value, int decimals, int x, int y);
+    int Percentile(int count, int percent);
+
+    SDL_Texture* atlas_;
+    SDL_Rect     glyphs_[kGlyphCount];
+    SDL_Rect     labels_[kLabelCount];
+    int          lineHeight_;
+
+    // The frame times in microseconds, a ring starting at head_.
+    int          history_[kHistory];
+    int          sorted_[kHistory];
+    int          head_;
+    int          count_;
+    SDL_Rect     bars_[kHistory];
+
+    RenderStats  stats_;
+    int          events_;
+    // What the last Draw() cost, in microseconds.
+    int          cost_;
+};
+
+#endif  // HUD_H_
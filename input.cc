@@ -0,0 +1,210 @@
+#include "input.h"
+
+#include "input_recorder.h"
+
+// The event types nobody reads, dropped before they reach the queue. Touch
+// still arrives as SDL's emulated mouse events.
+static const Uint32 kIgnoredEvents[] = {
+    SDL_SYSWMEVENT,
+    SDL_KEYMAPCHANGED,
+    SDL_JOYAXISMOTION, SDL_JOYBALLMOTION, SDL_JOYHATMOTION, SDL_JOYBUTTONDOWN,
+    SDL_JOYBUTTONUP, SDL_JOYDEVICEADDED, SDL_JOYDEVICEREMOVED,
+    SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERBUTTONDOWN, SDL_CONTROLLERBUTTONUP,
+    SDL_CONTROLLERDEVICEADDED, SDL_CONTROLLERDEVICEREMOVED, SDL_CONTROLLERDEVICEREMAPPED,
+    SDL_FINGERDOWN, SDL_FINGERUP, SDL_FINGERMOTION,
+    SDL_DOLLARGESTURE, SDL_DOLLARRECORD, SDL_MULTIGESTURE,
+    SDL_CLIPBOARDUPDATE,
+    SDL_DROPFILE, SDL_DROPTEXT, SDL_DROPBEGIN, SDL_DROPCOMPLETE,
+    SDL_AUDIODEVICEADDED, SDL_AUDIODEVICEREMOVED,
+    SDL_SENSORUPDATE,
+};
+
+Input::Input() : recorder_(NULL), frame_(0), timesLock_(0)
+{
+    SDL_zero(snapshot_);
+    SDL_zero(motionTimes_);
+    SDL_zero(otherTimes_);
+}
+
+void Input::Init()
+{
+    for (size_t i = 0; i < SDL_arraysize(kIgnoredEvents); ++i)
+        SDL_EventState(kIgnoredEvents[i], SDL_IGNORE);
+
+    SDL_SetEventFilter(Filter, this);
+}
+
+int SDLCALL Input::Filter(void* userdata, SDL_Event* event)
+{
+    // Only a few window events matter to us.
+    if (event->type == SDL_WINDOWEVENT)
+    {
+        switch (event->window.event)
+        {
+        case SDL_WINDOWEVENT_MOVED:
+        // SDL_WINDOWEVENT_SIZE_CHANGED follows every one of these.
+        case SDL_WINDOWEVENT_RESIZED:
+        case SDL_WINDOWEVENT_ENTER:
+        case SDL_WINDOWEVENT_LEAVE:
+        case SDL_WINDOWEVENT_TAKE_FOCUS:
+        case SDL_WINDOWEVENT_HIT_TEST:
+            return 0;
+        }
+    }
+
+    // Time input from when it's queued; the events' own timestamps are
+    // only in milliseconds.
+    if (event->type >= SDL_KEYDOWN && event->type < SDL_JOYAXISMOTION)
+    {
+        Input*      input = static_cast<Input*>(userdata);
+        Uint64      now   = SDL_GetPerformanceCounter();
+        SDL_AtomicLock(&input->timesLock_);
+        EventTimes& times = event->type == SDL_MOUSEMOTION ? input->motionTimes_
+                                                           : input->otherTimes_;
+        if (times.first == 0) times.first = now;
+        times.last = now;
+        SDL_AtomicUnlock(&input->timesLock_);
+    }
+
+    return 1;
+}
+
+const InputSnapshot& Input::Update()
+{
+    // Start from the held state of the last frame.
+    SDL_zero(snapshot_.keysPressed);
+    SDL_zero(snapshot_.keysReleased);
+    snapshot_.mouseDeltaX     = 0;
+    snapshot_.mouseDeltaY     = 0;
+    snapshot_.wheelX          = 0;
+    snapshot_.wheelY          = 0;
+    snapshot_.buttonsPressed  = 0;
+    snapshot_.buttonsReleased = 0;
+    snapshot_.text[0]         = '\0';
+    snapshot_.textLength      = 0;
+    snapshot_.eventCount      = 0;
+    snapshot_.resized         = false;
+    snapshot_.firstEventTime  = 0;
+    snapshot_.lastEventTime   = 0;
+
+    SDL_PumpEvents();
+    Drain(SDL_FIRSTEVENT, SDL_LASTEVENT, frame_++);
+    TakeEventTimes(motionTimes_);
+    TakeEventTimes(otherTimes_);
+
+    return snapshot_;
+}
+
+const InputSnapshot& Input::LatchLate()
+{
+    SDL_PumpEvents();
+    // Still part of the frame Update() built.
+    Drain(SDL_MOUSEMOTION, SDL_MOUSEMOTION, frame_ - 1);
+    TakeEventTimes(motionTimes_);
+
+    return snapshot_;
+}
+
+void Input::Drain(Uint32 minType, Uint32 maxType, unsigned frame)
+{
+    // Drain the queue a batch at a time, each call locks the queue once.
+    for (;;)
+    {
+        int count = SDL_PeepEvents(events_, kMaxEvents, SDL_GETEVENT, minType, maxType);
+        if (count <= 0) break;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (recorder_ != NULL) recorder_->Record(frame, events_[i]);
+            Apply(events_[i]);
+        }
+        snapshot_.eventCount += count;
+
+        if (count < kMaxEvents) break;
+    }
+}
+
+void Input::TakeEventTimes(EventTimes& times)
+{
+    SDL_AtomicLock(&timesLock_);
+    if (times.first != 0 &&
+        (snapshot_.firstEventTime == 0 || times.first < snapshot_.firstEventTime))
+        snapshot_.firstEventTime = times.first;
+    if (times.last > snapshot_.lastEventTime) snapshot_.lastEventTime = times.last;
+    SDL_zero(times);
+    SDL_AtomicUnlock(&timesLock_);
+}
+
+void Input::Apply(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+    case SDL_QUIT:
+        snapshot_.quit = true;
+        break;
+
+    // SDL_QUIT only comes once the last window is closed; closing any of
+    // several quits as well.
+    case SDL_WINDOWEVENT:
+        if (event.window.event == SDL_WINDOWEVENT_CLOSE)        snapshot_.quit    = true;
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) snapshot_.resized = true;
+        break;
+
+    case SDL_KEYDOWN:
+    {
+        int key = event.key.keysym.scancode;
+        if (!event.key.repeat) snapshot_.keysPressed[key >> 5] |= 1u << (key & 31);
+        snapshot_.keysDown[key >> 5] |= 1u << (key & 31);
+        break;
+    }
+
+    case SDL_KEYUP:
+    {
+        int key = event.key.keysym.scancode;
+        snapshot_.keysReleased[key >> 5] |= 1u << (key & 31);
+        snapshot_.keysDown[key >> 5]     &= ~(1u << (key & 31));
+        break;
+    }
+
+    case SDL_MOUSEMOTION:
+        snapshot_.mouseX       = event.motion.x;
+        snapshot_.mouseY       = event.motion.y;
+        snapshot_.mouseDeltaX += event.motion.xrel;
+        snapshot_.mouseDeltaY += event.motion.yrel;
+        break;
+
+    case SDL_MOUSEBUTTONDOWN:
+        snapshot_.mouseX          = event.button.x;
+        snapshot_.mouseY          = event.button.y;
+        snapshot_.buttonsPressed |= SDL_BUTTON(event.button.button);
+        snapshot_.buttonsDown    |= SDL_BUTTON(event.button.button);
+        break;
+
+    case SDL_MOUSEBUTTONUP:
+        snapshot_.mouseX           = event.button.x;
+        snapshot_.mouseY           = event.button.y;
+        snapshot_.buttonsReleased |= SDL_BUTTON(event.button.button);
+        snapshot_.buttonsDown     &= ~SDL_BUTTON(event.button.button);
+        break;
+
+    case SDL_MOUSEWHEEL:
+        snapshot_.wheelX += event.wheel.x;
+        snapshot_.wheelY += event.wheel.y;
+        break;
+
+    case SDL_TEXTINPUT:
+    {
+        // Drop what doesn't fit, there's no sensible way to type that fast.
+        int length = (int)SDL_strlen(event.text.text);
+        if (snapshot_.textLength + length < InputSnapshot::kMaxText)
+        {
+            SDL_memcpy(snapshot_.text + snapshot_.textLength, event.text.text, length + 1);
+            snapshot_.textLength += length;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include "SDL2/SDL.h"
+
+class InputRecorder;
+
+// The input of one frame. Gameplay code reads this instead of SDL events.
+struct InputSnapshot
+{
+    static const int kKeyWords = (SDL_NUM_SCANCODES + 31) / 32;
+    static const int kMaxText  = 64;
+
+    // Scancode bitsets: held, went down and went up this frame.
+    Uint32 keysDown[kKeyWords];
+    Uint32 keysPressed[kKeyWords];
+    Uint32 keysReleased[kKeyWords];
+
+    // The mouse position, its motion and the wheel during this frame.
+    int    mouseX;
+    int    mouseY;
+    int    mouseDeltaX;
+    int    mouseDeltaY;
+    int    wheelX;
+    int    wheelY;
+
+    // SDL_BUTTON() masks.
+    Uint32 buttonsDown;
+    Uint32 buttonsPressed;
+    Uint32 buttonsReleased;
+
+    // The UTF-8 text typed this frame.
+    char   text[kMaxText];
+    int    textLength;
+
+    bool   quit;
+    // Whether any window changed its size this frame.
+    bool   resized;
+    // The events drained this frame.
+    int    eventCount;
+
+    // When the oldest and newest input event of this frame reached the
+    // queue, in SDL_GetPerformanceCounter() units; 0 without input.
+    Uint64 firstEventTime;
+    Uint64 lastEventTime;
+
+    bool IsKeyDown(SDL_Scancode key) const { return TestKey(keysDown, key); }
+    bool WasKeyPressed(SDL_Scancode key) const { return TestKey(keysPressed, key); }
+    bool WasKeyReleased(SDL_Scancode key) const { return TestKey(keysReleased, key); }
+
+    static bool TestKey(const Uint32* bits, SDL_Scancode key)
+    {
+        return (bits[key >> 5] >> (key & 31)) & 1;
+    }
+};
+
+// Drains SDL's event queue in bulk once per frame into an InputSnapshot.
+// Event types nobody reads are switched off at the source.
+class Input
+{
+public:
+    // The events drained per SDL_PeepEvents call.
+    static const int kMaxEvents = 256;
+
+    Input();
+
+    // Switch off the unused event types and install the event filter. Call
+    // after SDL_Init().
+    void Init();
+
+    // Pump and drain the event queue, and build this frame's snapshot.
+    const InputSnapshot& Update();
+
+    // Pump again and fold in only the mouse motion that arrived since
+    // Update(), right before the cursor-like draws get built. Other events
+    // stay queued for the next frame.
+    const InputSnapshot& LatchLate();
+
+    const InputSnapshot& GetSnapshot() { return snapshot_; }
+
+    // Log every drained event, tagged with the frame it was drained in.
+    void SetRecorder(InputRecorder* recorder) { recorder_ = recorder; }
+
+    // The frames built by Update() so far.
+    unsigned GetFrame() { return frame_; }
+
+private:
+    // When the input events still in the queue got there.
+    struct EventTimes
+    {
+        Uint64 first;
+        Uint64 last;
+    };
+
+    // Stamps the input events as they're queued, on whichever thread queues
+    // them.
+    static int SDLCALL Filter(void* userdata, SDL_Event* event);
+    // Drain the events of the types [minType, maxType] for the frame.
+    void Drain(Uint32 minType, Uint32 maxType, unsigned frame);
+    void Apply(const SDL_Event& event);
+    // Fold the times of drained events into the snapshot.
+    void TakeEventTimes(EventTimes& times);
+
+    SDL_Event      events_[kMaxEvents];
+    InputSnapshot  snapshot_;
+    InputRecorder* recorder_;
+    unsigned       frame_;
+
+    // LatchLate() drains the mouse motion alone, so it's timed apart.
+    SDL_SpinLock   timesLock_;
+    EventTimes     motionTimes_;
+    EventTimes     otherTimes_;
+};
+
+#endif  // INPUT_H_
@@ -0,0 +1,150 @@
+#include "input_recorder.h"
+
+#include "asset_watcher.h"
+
+// The log header, followed by the records.
+static const char kLogMagic[8] = {'S', 'D', 'L', 'R', 'E', 'C', '1', '\0'};
+
+// Frame, time and payload size.
+static const size_t kRecordHeaderSize = 4 + 8 + 1;
+
+// Write out the buffered records once this much piled up.
+static const size_t kFlushSize = 64 * 1024;
+
+static void PutLE32(std::vector<Uint8>& out, Uint32 value)
+{
+    for (int i = 0; i < 4; ++i) out.push_back((Uint8)(value >> (i * 8)));
+}
+
+static void PutLE64(std::vector<Uint8>& out, Uint64 value)
+{
+    for (int i = 0; i < 8; ++i) out.push_back((Uint8)(value >> (i * 8)));
+}
+
+static Uint32 GetLE32(const Uint8* in)
+{
+    return (Uint32)in[0] | ((Uint32)in[1] << 8) | ((Uint32)in[2] << 16) | ((Uint32)in[3] << 24);
+}
+
+int GetEventPayloadSize(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+    case SDL_QUIT:            return (int)sizeof(SDL_QuitEvent);
+    case SDL_WINDOWEVENT:     return (int)sizeof(SDL_WindowEvent);
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:           return (int)sizeof(SDL_KeyboardEvent);
+    case SDL_TEXTINPUT:       return (int)sizeof(SDL_TextInputEvent);
+    case SDL_MOUSEMOTION:     return (int)sizeof(SDL_MouseMotionEvent);
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:   return (int)sizeof(SDL_MouseButtonEvent);
+    case SDL_MOUSEWHEEL:      return (int)sizeof(SDL_MouseWheelEvent);
+    default:                  return (int)sizeof(SDL_Event);
+    }
+}
+
+InputRecorder::InputRecorder() : file_(NULL), start_(0) {}
+
+InputRecorder::~InputRecorder() { Close(); }
+
+bool InputRecorder::Open(const std::string& path)
+{
+    Close();
+
+    file_ = SDL_RWFromFile(path.c_str(), "wb");
+    if (file_ == NULL) return false;
+
+    buffer_.assign(kLogMagic, kLogMagic + sizeof(kLogMagic));
+    start_ = SDL_GetPerformanceCounter();
+    return true;
+}
+
+void InputRecorder::Close()
+{
+    if (file_ == NULL) return;
+
+    Flush();
+    SDL_RWclose(file_);
+    file_ = NULL;
+}
+
+void InputRecorder::Record(unsigned frame, const SDL_Event& event)
+{
+    if (file_ == NULL) return;
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start_;
+    int    size    = GetEventPayloadSize(event);
+
+    PutLE32(buffer_, frame);
+    PutLE64(buffer_, elapsed * 1000000 / SDL_GetPerformanceFrequency());
+    buffer_.push_back((Uint8)size);
+    buffer_.insert(buffer_.end(), (const Uint8*)&event, (const Uint8*)&event + size);
+
+    if (buffer_.size() >= kFlushSize) Flush();
+}
+
+void InputRecorder::Flush()
+{
+    if (!buffer_.empty()) SDL_RWwrite(file_, &buffer_[0], 1, buffer_.size());
+    buffer_.clear();
+}
+
+InputReplayer::InputReplayer() : offset_(0), frameCount_(0) {}
+
+bool InputReplayer::Open(const std::string& path)
+{
+    Close();
+
+    std::vector<char> bytes;
+    if (!ReadAssetFile(path, bytes)) return false;
+    if (bytes.size() < sizeof(kLogMagic) ||
+        SDL_memcmp(&bytes[0], kLogMagic, sizeof(kLogMagic)) != 0)
+    {
+        SDL_SetError("%s is not an input log", path.c_str());
+        return false;
+    }
+
+    data_.assign(bytes.begin(), bytes.end());
+    offset_ = sizeof(kLogMagic);
+
+    // The replay runs up to the last recorded frame.
+    for (size_t at = offset_; at + kRecordHeaderSize <= data_.size();
+         at += kRecordHeaderSize + data_[at + 12])
+        frameCount_ = (int)GetLE32(&data_[at]) + 1;
+
+    return true;
+}
+
+void InputReplayer::Close()
+{
+    data_.clear();
+    offset_     = 0;
+    frameCount_ = 0;
+}
+
+bool InputReplayer::PushFrame(unsigned frame)
+{
+    if (data_.empty()) return false;
+
+    // Replace the live input with the recorded one, but keep the window
+    // events and SDL_QUIT so the replay can still be closed.
+    SDL_PumpEvents();
+    SDL_FlushEvents(SDL_KEYDOWN, SDL_MULTIGESTURE);
+
+    while (offset_ + kRecordHeaderSize <= data_.size())
+    {
+        const Uint8* record = &data_[offset_];
+        int          size   = record[12];
+        if (GetLE32(record) > frame) break;
+        if (offset_ + kRecordHeaderSize + size > data_.size()) break;
+
+        SDL_Event event;
+        SDL_zero(event);
+        SDL_memcpy(&event, record + kRecordHeaderSize, SDL_min(size, (int)sizeof(event)));
+        SDL_PushEvent(&event);
+
+        offset_ += kRecordHeaderSize + size;
+    }
+
+    return (int)frame < frameCount_;
+}
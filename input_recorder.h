@@ -0,0 +1,61 @@
+#ifndef INPUT_RECORDER_H_
+#define INPUT_RECORDER_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+// Writes every drained SDL_Event with its frame index and time to a compact
+// binary log. Each record is the frame (LE32), the microseconds since the
+// recording started (LE64), the payload size (U8) and the event bytes up to
+// the end of its type's struct.
+class InputRecorder
+{
+public:
+    InputRecorder();
+    ~InputRecorder();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() { return file_ != NULL; }
+
+    void Record(unsigned frame, const SDL_Event& event);
+
+private:
+    void Flush();
+
+    SDL_RWops*         file_;
+    Uint64             start_;
+    std::vector<Uint8> buffer_;
+};
+
+// Feeds a log written by InputRecorder back through SDL_PushEvent, frame by
+// frame, in place of the live input.
+class InputReplayer
+{
+public:
+    InputReplayer();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() { return !data_.empty(); }
+
+    // Drop the live input and push the events recorded for the frame.
+    // Returns false once the log has run out.
+    bool PushFrame(unsigned frame);
+
+    int GetFrameCount() { return frameCount_; }
+
+private:
+    std::vector<Uint8> data_;
+    size_t             offset_;
+    int                frameCount_;
+};
+
+// The bytes of the event that matter for its type.
+int GetEventPayloadSize(const SDL_Event& event);
+
+#endif  // INPUT_RECORDER_H_
@@ -0,0 +1,407 @@
+#include "job_system.h"
+
+// Failed attempts to find a job before a worker goes to sleep.
+static const int kSpinsBeforeSleep = 64;
+
+struct Job
+{
+    JobFunc         func;
+    // Set instead of func for the chunks of a parallel loop.
+    ParallelForFunc rangeFunc;
+    void*           data;
+    int             begin;
+    int             end;
+
+    JobCounter*     counter;
+    // The next job waiting for the same counter.
+    Job*            next;
+    // Jobs from foreign threads, or from a worker with its pool in flight,
+    // come from the heap.
+    bool            heap;
+    // Set on a pool job from its allocation until it has run.
+    SDL_atomic_t    busy;
+};
+
+JobCounter::JobCounter() : lock_(0), waiting_(NULL)
+{
+    SDL_AtomicSet(&count_, 0);
+}
+
+JobSystem::Deque::Deque()
+{
+    SDL_AtomicSet(&top_, 0);
+    SDL_AtomicSet(&bottom_, 0);
+    for (int i = 0; i < kCapacity; ++i) jobs_[i] = NULL;
+}
+
+// The indices wrap around, so they're only ever compared by difference.
+bool JobSystem::Deque::Push(Job* job)
+{
+    unsigned b = (unsigned)SDL_AtomicGet(&bottom_);
+    unsigned t = (unsigned)SDL_AtomicGet(&top_);
+    if ((int)(b - t) >= kCapacity) return false;
+
+    SDL_AtomicSetPtr(&jobs_[b & (kCapacity - 1)], job);
+    // Publish the job before the new bottom.
+    SDL_AtomicSet(&bottom_, (int)(b + 1));
+
+    return true;
+}
+
+Job* JobSystem::Deque::Pop()
+{
+    // Reserve the bottom job first, the exchange orders it before reading top.
+    unsigned b = (unsigned)SDL_AtomicGet(&bottom_) - 1;
+    SDL_AtomicSet(&bottom_, (int)b);
+    unsigned t = (unsigned)SDL_AtomicGet(&top_);
+
+    if ((int)(b - t) < 0)
+    {
+        // Empty.
+        SDL_AtomicSet(&bottom_, (int)(b + 1));
+        return NULL;
+    }
+
+    Job* job = static_cast<Job*>(SDL_AtomicGetPtr(&jobs_[b & (kCapacity - 1)]));
+    if (b == t)
+    {
+        // The last job, race the thieves for it.
+        if (!SDL_AtomicCAS(&top_, (int)t, (int)(t + 1))) job = NULL;
+        SDL_AtomicSet(&bottom_, (int)(b + 1));
+    }
+
+    return job;
+}
+
+Job* JobSystem::Deque::Steal()
+{
+    unsigned t = (unsigned)SDL_AtomicGet(&top_);
+    unsigned b = (unsigned)SDL_AtomicGet(&bottom_);
+    if ((int)(b - t) <= 0) return NULL;
+
+    Job* job = static_cast<Job*>(SDL_AtomicGetPtr(&jobs_[t & (kCapacity - 1)]));
+    if (!SDL_AtomicCAS(&top_, (int)t, (int)(t + 1))) return NULL;
+
+    return job;
+}
+
+JobSystem::JobSystem()
+    : threads_(NULL), workerCount_(0), workers_(NULL), workerSlots_(0), workerTls_(0),
+      injectLock_(NULL), wake_(NULL)
+{
+    SDL_AtomicSet(&attached_, 0);
+    SDL_AtomicSet(&injectedCount_, 0);
+    SDL_AtomicSet(&sleeping_, 0);
+    SDL_AtomicSet(&quit_, 0);
+}
+
+JobSystem::~JobSystem() { Shutdown(); }
+
+bool JobSystem::Init(int workers, int attachedThreads)
+{
+    if (workers < 0) workers = SDL_GetCPUCount() - 1;
+    if (workers < 0) workers = 0;
+
+    injectLock_ = SDL_CreateMutex();
+    wake_       = SDL_CreateSemaphore(0);
+    workerTls_  = SDL_TLSCreate();
+    if (injectLock_ == NULL || wake_ == NULL || workerTls_ == 0) return false;
+
+    workerSlots_ = workers + 1 + SDL_max(attachedThreads, 0);
+    workers_     = new Worker[workerSlots_];
+    for (int i = 0; i < workerSlots_; ++i)
+    {
+        workers_[i].owner    = this;
+        workers_[i].index    = i;
+        workers_[i].pool     = new Job[kMaxJobsPerThread]();
+        workers_[i].poolNext = 0;
+    }
+
+    // The calling thread owns the slot after the workers.
+    SDL_TLSSet(workerTls_, &workers_[workers], NULL);
+    SDL_AtomicSet(&attached_, workers + 1);
+
+    SDL_AtomicSet(&quit_, 0);
+    threads_ = new SDL_Thread*[workers];
+    for (workerCount_ = 0; workerCount_ < workers; ++workerCount_)
+    {
+        threads_[workerCount_] = SDL_CreateThread(WorkerMain, "JobWorker", &workers_[workerCount_]);
+        if (threads_[workerCount_] == NULL) return false;
+    }
+
+    return true;
+}
+
+void JobSystem::Shutdown()
+{
+    if (threads_ != NULL)
+    {
+        SDL_AtomicSet(&quit_, 1);
+        for (int i = 0; i < workerCount_; ++i) SDL_SemPost(wake_);
+        for (int i = 0; i < workerCount_; ++i) SDL_WaitThread(threads_[i], NULL);
+        delete[] threads_;
+    }
+
+    if (workers_ != NULL)
+    {
+        SDL_TLSSet(workerTls_, NULL, NULL);
+        for (int i = 0; i < workerSlots_; ++i) delete[] workers_[i].pool;
+        delete[] workers_;
+    }
+
+    for (size_t i = 0; i < injected_.size(); ++i) delete injected_[i];
+    injected_.clear();
+
+    if (wake_ != NULL)       SDL_DestroySemaphore(wake_);
+    if (injectLock_ != NULL) SDL_DestroyMutex(injectLock_);
+
+    threads_     = NULL;
+    workerCount_ = 0;
+    workers_     = NULL;
+    workerSlots_ = 0;
+    wake_        = NULL;
+    injectLock_  = NULL;
+}
+
+bool JobSystem::AttachThread()
+{
+    if (workers_ == NULL) return false;
+    if (GetCurrentWorker() != NULL) return true;
+
+    int slot = SDL_AtomicAdd(&attached_, 1);
+    if (slot >= workerSlots_) return false;
+
+    SDL_TLSSet(workerTls_, &workers_[slot], NULL);
+    return true;
+}
+
+void JobSystem::Schedule(JobFunc func, void* data, JobCounter* counter, JobCounter* dependency)
+{
+    Job* job       = AllocateJob(GetCurrentWorker());
+    job->func      = func;
+    job->rangeFunc = NULL;
+    job->data      = data;
+    job->counter   = counter;
+
+    if (counter != NULL) SDL_AtomicAdd(&counter->count_, 1);
+
+    if (dependency != NULL)
+    {
+        // Park the job on the dependency; the last job of the dependency
+        // takes the lock before it releases the waiting list.
+        SDL_AtomicLock(&dependency->lock_);
+        bool parked = SDL_AtomicGet(&dependency->count_) > 0;
+        if (parked)
+        {
+            job->next            = dependency->waiting_;
+            dependency->waiting_ = job;
+        }
+        SDL_AtomicUnlock(&dependency->lock_);
+
+        if (parked) return;
+    }
+
+    Submit(job);
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+    Worker* worker = GetCurrentWorker();
+    while (!counter->IsDone())
+    {
+        Job* job = FindJob(worker);
+        if (job != NULL) Run(job);
+        else             SDL_Delay(0);
+    }
+
+    // The last job may still hold the lock, wait for it before the counter
+    // goes out of scope.
+    SDL_AtomicLock(&counter->lock_);
+    SDL_AtomicUnlock(&counter->lock_);
+}
+
+void JobSystem::ParallelFor(int count, int grain, ParallelForFunc func, void* data)
+{
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+
+    // Keep well within the job pool of the calling thread.
+    const int maxChunks = kMaxJobsPerThread / 4;
+    if ((count + grain - 1) / grain > maxChunks) grain = (count + maxChunks - 1) / maxChunks;
+
+    // Not worth waking anybody up.
+    if (workerCount_ == 0 || count <= grain)
+    {
+        func(data, 0, count);
+        return;
+    }
+
+    Worker*    worker = GetCurrentWorker();
+    JobCounter counter;
+    for (int begin = 0; begin < count; begin += grain)
+    {
+        Job* job       = AllocateJob(worker);
+        job->func      = NULL;
+        job->rangeFunc = func;
+        job->data      = data;
+        job->begin     = begin;
+        job->end       = SDL_min(begin + grain, count);
+        job->counter   = &counter;
+
+        SDL_AtomicAdd(&counter.count_, 1);
+        Submit(job);
+    }
+
+    Wait(&counter);
+}
+
+int SDLCALL JobSystem::WorkerMain(void* data)
+{
+    Worker*    worker = static_cast<Worker*>(data);
+    JobSystem* jobs   = worker->owner;
+    SDL_TLSSet(jobs->workerTls_, worker, NULL);
+
+    int idle = 0;
+    while (SDL_AtomicGet(&jobs->quit_) == 0)
+    {
+        Job* job = jobs->FindJob(worker);
+        if (job != NULL)
+        {
+            jobs->Run(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < kSpinsBeforeSleep)
+        {
+            SDL_Delay(0);
+            continue;
+        }
+
+        // Announce the sleep before the last look, so a concurrent Submit()
+        // either sees the sleeper or the sleeper sees its job.
+        SDL_AtomicAdd(&jobs->sleeping_, 1);
+        job = jobs->FindJob(worker);
+        if (job == NULL) SDL_SemWaitTimeout(jobs->wake_, 100);
+        SDL_AtomicAdd(&jobs->sleeping_, -1);
+
+        if (job != NULL) jobs->Run(job);
+        idle = 0;
+    }
+
+    return 0;
+}
+
+JobSystem::Worker* JobSystem::GetCurrentWorker()
+{
+    if (workers_ == NULL) return NULL;
+
+    Worker* worker = static_cast<Worker*>(SDL_TLSGet(workerTls_));
+    return worker != NULL && worker->owner == this ? worker : NULL;
+}
+
+Job* JobSystem::AllocateJob(Worker* worker)
+{
+    // Only the owner allocates from its pool, so the ring needs no locking.
+    Job* job = worker != NULL ? &worker->pool[worker->poolNext++ & (kMaxJobsPerThread - 1)] : NULL;
+    if (job == NULL || SDL_AtomicGet(&job->busy) != 0)
+    {
+        // The slot's job is still queued, parked or running.
+        job       = new Job;
+        job->heap = true;
+        return job;
+    }
+
+    SDL_AtomicSet(&job->busy, 1);
+    job->heap = false;
+    return job;
+}
+
+void JobSystem::Submit(Job* job)
+{
+    job->next = NULL;
+
+    Worker* worker = GetCurrentWorker();
+    if (workerCount_ == 0 || (worker != NULL && !worker->deque.Push(job)))
+    {
+        // No workers, or the deque is full: run it right here.
+        Run(job);
+        return;
+    }
+
+    if (worker == NULL)
+    {
+        SDL_LockMutex(injectLock_);
+        injected_.push_back(job);
+        SDL_AtomicAdd(&injectedCount_, 1);
+        SDL_UnlockMutex(injectLock_);
+    }
+
+    if (SDL_AtomicGet(&sleeping_) > 0) SDL_SemPost(wake_);
+}
+
+Job* JobSystem::FindJob(Worker* worker)
+{
+    if (worker != NULL)
+    {
+        Job* job = worker->deque.Pop();
+        if (job != NULL) return job;
+    }
+
+    if (SDL_AtomicGet(&injectedCount_) > 0)
+    {
+        Job* job = NULL;
+        SDL_LockMutex(injectLock_);
+        if (!injected_.empty())
+        {
+            job = injected_.back();
+            injected_.pop_back();
+            SDL_AtomicAdd(&injectedCount_, -1);
+        }
+        SDL_UnlockMutex(injectLock_);
+
+        if (job != NULL) return job;
+    }
+
+    // Start stealing next to ourselves, so the thieves spread out.
+    int start = worker != NULL ? worker->index + 1 : 0;
+    for (int i = 0; i < workerSlots_; ++i)
+    {
+        Worker& victim = workers_[(start + i) % workerSlots_];
+        if (&victim == worker) continue;
+
+        Job* job = victim.deque.Steal();
+        if (job != NULL) return job;
+    }
+
+    return NULL;
+}
+
+void JobSystem::Run(Job* job)
+{
+    if (job->func != NULL) job->func(job->data);
+    else                   job->rangeFunc(job->data, job->begin, job->end);
+
+    JobCounter* counter = job->counter;
+    if (job->heap) delete job;
+    else           SDL_AtomicSet(&job->busy, 0);
+    if (counter == NULL) return;
+
+    // The last job of a counter releases the jobs waiting on it. The count
+    // drops under the lock so Wait() can tell when the counter is let go.
+    Job* waiting = NULL;
+    SDL_AtomicLock(&counter->lock_);
+    if (SDL_AtomicAdd(&counter->count_, -1) == 1)
+    {
+        waiting           = counter->waiting_;
+        counter->waiting_ = NULL;
+    }
+    SDL_AtomicUnlock(&counter->lock_);
+
+    while (waiting != NULL)
+    {
+        Job* next = waiting->next;
+        Submit(waiting);
+        waiting = next;
+    }
+}
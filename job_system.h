@@ -0,0 +1,134 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+// A job entry point.
+typedef void (*JobFunc)(void* data);
+
+// Processes the items [begin, end) of a parallel loop.
+typedef void (*ParallelForFunc)(void* data, int begin, int end);
+
+struct Job;
+
+// Counts the unfinished jobs of a group. Jobs can be made to wait for a
+// counter to drop to zero, and threads can help out until it does.
+class JobCounter
+{
+public:
+    JobCounter();
+
+    bool IsDone() { return SDL_AtomicGet(&count_) == 0; }
+
+private:
+    friend class JobSystem;
+
+    SDL_atomic_t count_;
+
+    // The jobs waiting for the counter to drop to zero.
+    SDL_SpinLock lock_;
+    Job*         waiting_;
+};
+
+// The shared worker pool, sized from SDL_GetCPUCount(). Every worker and the
+// thread that called Init() own a Chase-Lev work-stealing deque: the owner
+// pushes and pops at the bottom without locks, idle workers steal from the
+// top. Other threads hand their jobs in through a locked queue.
+class JobSystem
+{
+public:
+    // The jobs one thread may have in flight at once.
+    static const int kMaxJobsPerThread = 4096;
+
+    JobSystem();
+    ~JobSystem();
+
+    // Start the workers, by default one less than the number of cores since
+    // the calling thread helps out, and leave room for attachedThreads
+    // threads to attach on top.
+    bool Init(int workers = -1, int attachedThreads = 2);
+    void Shutdown();
+
+    int WorkerCount() { return workerCount_; }
+
+    // Give a long lived thread other than the workers and the one that
+    // called Init() its own deque, so its jobs skip the locked queue.
+    bool AttachThread();
+
+    // Run func(data) on the pool. The counter, if any, counts the job until
+    // it finishes; the job won't start before the dependency drops to zero.
+    void Schedule(JobFunc func, void* data, JobCounter* counter = NULL,
+                  JobCounter* dependency = NULL);
+
+    // Run other jobs on the calling thread until the counter drops to zero.
+    void Wait(JobCounter* counter);
+
+    // Split [0, count) into chunks of grain items, run them on the pool and
+    // return once every chunk is done.
+    void ParallelFor(int count, int grain, ParallelForFunc func, void* data);
+
+private:
+    // A fixed size Chase-Lev deque of job pointers.
+    class Deque
+    {
+    public:
+        Deque();
+
+        // Owner only.
+        bool Push(Job* job);
+        Job* Pop();
+        // Any thread.
+        Job* Steal();
+
+    private:
+        static const int kCapacity = kMaxJobsPerThread;
+
+        SDL_atomic_t top_;
+        SDL_atomic_t bottom_;
+        void*        jobs_[kCapacity];
+    };
+
+    struct Worker
+    {
+        JobSystem* owner;
+        int        index;
+        Deque      deque;
+
+        // The owner's jobs, handed out round robin while they're free.
+        Job*       pool;
+        unsigned   poolNext;
+    };
+
+    static int SDLCALL WorkerMain(void* data);
+
+    // The worker of the calling thread, NULL for foreign threads.
+    Worker* GetCurrentWorker();
+    Job*    AllocateJob(Worker* worker);
+    void    Submit(Job* job);
+    Job*    FindJob(Worker* worker);
+    void    Run(Job* job);
+
+    SDL_Thread**      threads_;
+    int               workerCount_;
+
+    // One worker per thread, the one after the workers belongs to the thread
+    // that called Init(), the rest are handed out by AttachThread().
+    Worker*           workers_;
+    int               workerSlots_;
+    SDL_atomic_t      attached_;
+    SDL_TLSID         workerTls_;
+
+    // Jobs handed in by other threads.
+    SDL_mutex*        injectLock_;
+    std::vector<Job*> injected_;
+    SDL_atomic_t      injectedCount_;
+
+    // Parks idle workers until jobs get pushed.
+    SDL_sem*          wake_;
+    SDL_atomic_t      sleeping_;
+    SDL_atomic_t      quit_;
+};
+
+#endif  // JOB_SYSTEM_H_
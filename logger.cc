@@ -0,0 +1,386 @@
+#include "logger.h"
+
+#include <iostream>
+#include <sstream>
+
+// The records a thread can have waiting, and the threads that get a ring.
+static const int kRingSize = 256;
+static const int kMaxRings = 32;
+// The arguments of a message, and the bytes of its copied strings.
+static const int kMaxArgs  = 6;
+static const int kTextSize = 192;
+// The formats per thread whose repeats are tracked, and how long a message
+// holds back its repeats.
+static const int kRepeatSlots   = 16;
+static const int kRepeatSeconds = 1;
+// How often the background thread writes out what's there.
+static const int kFlushMs = 10;
+
+struct LogRecord
+{
+    const char*     format;
+    SDL_LogPriority priority;
+    // The repeats held back since the last one that got through.
+    int             repeats;
+    int             argCount;
+    LogArg::Type    types[kMaxArgs];
+    // A string's value is its offset in the text.
+    union
+    {
+        Sint64 i;
+        Uint64 u;
+        double d;
+    } values[kMaxArgs];
+    char            text[kTextSize];
+};
+
+// The last message through per format and arguments, on the producer's
+// side only. Its record is written out with the held count when another
+// message takes the slot, or at shutdown.
+struct RepeatSlot
+{
+    LogRecord record;
+    Uint32    hash;
+    Uint64    until;
+    int       held;
+};
+
+// A single producer, single consumer ring. The producer writes the record at
+// head and then moves head on; the consumer reads up to head and then moves
+// tail on.
+struct LogRing
+{
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    RepeatSlot   repeats[kRepeatSlots];
+    LogRecord    records[kRingSize];
+};
+
+static SDL_atomic_t  g_running;
+static SDL_Thread*   g_thread   = NULL;
+static SDL_sem*      g_wake     = NULL;
+static SDL_atomic_t  g_quit;
+static SDL_TLSID     g_ringTls  = 0;
+static SDL_atomic_t  g_ringCount;
+static void*         g_rings[kMaxRings];
+static SDL_atomic_t  g_dropped;
+static Uint64        g_repeatTicks;
+
+static SDL_LogOutputFunction g_sdlOutput     = NULL;
+static void*                 g_sdlOutputData = NULL;
+
+// Copy the arguments into the record, strings into its text as far as they
+// fit.
+static void Capture(LogRecord& record, const LogArg* args)
+{
+    int used        = 0;
+    record.argCount = 0;
+    for (int i = 0; i < kMaxArgs && args[i].GetType() != LogArg::kNone; ++i)
+    {
+        LogArg::Type type = args[i].GetType();
+        record.types[i]   = type;
+        if (type == LogArg::kInt)           record.values[i].i = args[i].GetInt();
+        else if (type == LogArg::kUnsigned) record.values[i].u = args[i].GetUnsigned();
+        else if (type == LogArg::kDouble)   record.values[i].d = args[i].GetDouble();
+        else
+        {
+            const char* text   = args[i].GetString();
+            int         length = SDL_min((int)SDL_strlen(text), kTextSize - 1 - used);
+            SDL_memcpy(record.text + used, text, length);
+            record.text[used + length] = '\0';
+            record.values[i].i         = used;
+            used += SDL_min(length + 1, kTextSize - 1 - used);
+        }
+        ++record.argCount;
+    }
+}
+
+// FNV-1a over the arguments, so the same format with other values isn't
+// taken for a repeat.
+static Uint32 HashArgs(const LogArg* args)
+{
+    Uint32 hash = 2166136261u;
+    for (int i = 0; i < kMaxArgs && args[i].GetType() != LogArg::kNone; ++i)
+    {
+        if (args[i].GetType() == LogArg::kString)
+        {
+            for (const char* c = args[i].GetString(); *c != '\0'; ++c)
+                hash = (hash ^ (Uint8)*c) * 16777619u;
+            continue;
+        }
+
+        // The bits of the number, whichever its type.
+        Uint64 value = args[i].GetUnsigned();
+        for (int shift = 0; shift < 64; shift += 8)
+            hash = (hash ^ (Uint8)(value >> shift)) * 16777619u;
+    }
+
+    return hash;
+}
+
+static void Format(const LogRecord& record, std::ostringstream& out)
+{
+    if (record.priority >= SDL_LOG_PRIORITY_ERROR) out << "[error] ";
+    else if (record.priority == SDL_LOG_PRIORITY_WARN) out << "[warning] ";
+
+    // Each {} takes the next argument; extra ones stay as they are.
+    int arg = 0;
+    for (const char* c = record.format; *c != '\0'; ++c)
+    {
+        if (c[0] != '{' || c[1] != '}' || arg >= record.argCount)
+        {
+            out << *c;
+            continue;
+        }
+
+        switch (record.types[arg])
+        {
+        case LogArg::kInt:      out << record.values[arg].i; break;
+        case LogArg::kUnsigned: out << record.values[arg].u; break;
+        case LogArg::kDouble:   out << record.values[arg].d; break;
+        default:                out << record.text + record.values[arg].i; break;
+        }
+        ++arg;
+        ++c;
+    }
+
+    if (record.repeats > 0) out << " (and " << record.repeats << " more like it)";
+    out << "\n";
+}
+
+// The calling thread's ring, taken on its first message. NULL when they're
+// all taken.
+static LogRing* GetRing()
+{
+    LogRing* ring = static_cast<LogRing*>(SDL_TLSGet(g_ringTls));
+    if (ring != NULL) return ring;
+
+    int index = SDL_AtomicAdd(&g_ringCount, 1);
+    if (index >= kMaxRings) return NULL;
+
+    // Once per thread; the rings live until shutdown.
+    ring = new LogRing;
+    SDL_zerop(ring);
+    SDL_TLSSet(g_ringTls, ring, NULL);
+    SDL_AtomicSetPtr(&g_rings[index], ring);
+    return ring;
+}
+
+// The record to fill in at the ring's head, NULL when the ring is full.
+static LogRecord* BeginPush(LogRing* ring)
+{
+    unsigned head = (unsigned)SDL_AtomicGet(&ring->head);
+    if (head - (unsigned)SDL_AtomicGet(&ring->tail) >= (unsigned)kRingSize)
+    {
+        SDL_AtomicAdd(&g_dropped, 1);
+        return NULL;
+    }
+
+    return &ring->records[head % kRingSize];
+}
+
+static void EndPush(LogRing* ring)
+{
+    unsigned head = (unsigned)SDL_AtomicGet(&ring->head) + 1;
+    SDL_AtomicSet(&ring->head, (int)head);
+
+    // Don't wait out the interval with the ring filling up.
+    if (head - (unsigned)SDL_AtomicGet(&ring->tail) == (unsigned)kRingSize / 2 + 1)
+        SDL_SemPost(g_wake);
+}
+
+// Queue the slot's held repeats as one record: the message once and how
+// many more there were.
+static void PushHeld(LogRing* ring, RepeatSlot& slot)
+{
+    if (slot.held == 0) return;
+
+    LogRecord* record = BeginPush(ring);
+    if (record != NULL)
+    {
+        *record         = slot.record;
+        record->repeats = slot.held - 1;
+        EndPush(ring);
+    }
+    slot.held = 0;
+}
+
+// Write out every ring's records. Background thread only.
+static void Drain()
+{
+    std::ostringstream out;
+    int                count = SDL_min(SDL_AtomicGet(&g_ringCount), kMaxRings);
+    for (int i = 0; i < count; ++i)
+    {
+        LogRing* ring = static_cast<LogRing*>(SDL_AtomicGetPtr(&g_rings[i]));
+        if (ring == NULL) continue;
+
+        // Unsigned, so the counts wrap around cleanly.
+        unsigned tail = (unsigned)SDL_AtomicGet(&ring->tail);
+        unsigned head = (unsigned)SDL_AtomicGet(&ring->head);
+        for (; tail != head; ++tail) Format(ring->records[tail % kRingSize], out);
+        SDL_AtomicSet(&ring->tail, (int)tail);
+    }
+
+    // One write and flush per batch, not per message.
+    std::string text = out.str();
+    if (!text.empty()) std::cout << text << std::flush;
+}
+
+static int SDLCALL LogThread(void*)
+{
+    while (SDL_AtomicGet(&g_quit) == 0)
+    {
+        SDL_SemWaitTimeout(g_wake, kFlushMs);
+        Drain();
+    }
+    Drain();
+
+    return 0;
+}
+
+static void Post(SDL_LogPriority priority, const char* format, const LogArg* args, bool limit);
+
+// SDL's messages all share one format, so they aren't rate limited.
+static void SDLCALL OnSdlLog(void*, int, SDL_LogPriority priority, const char* message)
+{
+    const LogArg args[kMaxArgs] = {message};
+    Post(priority, "SDL: {}", args, false);
+}
+
+bool InitLog()
+{
+    if (SDL_AtomicGet(&g_running) != 0) return true;
+
+    SDL_AtomicSet(&g_quit, 0);
+    SDL_AtomicSet(&g_ringCount, 0);
+    SDL_AtomicSet(&g_dropped, 0);
+    SDL_zero(g_rings);
+    g_repeatTicks = SDL_GetPerformanceFrequency() * kRepeatSeconds;
+
+    if (g_ringTls == 0) g_ringTls = SDL_TLSCreate();
+    g_wake = SDL_CreateSemaphore(0);
+    if (g_ringTls == 0 || g_wake == NULL) return false;
+
+    g_thread = SDL_CreateThread(LogThread, "Log", NULL);
+    if (g_thread == NULL)
+    {
+        SDL_DestroySemaphore(g_wake);
+        g_wake = NULL;
+        return false;
+    }
+
+    SDL_AtomicSet(&g_running, 1);
+    SDL_LogGetOutputFunction(&g_sdlOutput, &g_sdlOutputData);
+    SDL_LogSetOutputFunction(OnSdlLog, NULL);
+    return true;
+}
+
+void ShutdownLog()
+{
+    if (SDL_AtomicGet(&g_running) == 0) return;
+
+    SDL_LogSetOutputFunction(g_sdlOutput, g_sdlOutputData);
+    SDL_AtomicSet(&g_quit, 1);
+    SDL_SemPost(g_wake);
+    SDL_WaitThread(g_thread, NULL);
+    SDL_DestroySemaphore(g_wake);
+    g_thread = NULL;
+    g_wake   = NULL;
+    SDL_AtomicSet(&g_running, 0);
+
+    // Threads that log from now on write right away and take no ring. The
+    // repeats still held back get written out first.
+    std::ostringstream out;
+    int                count = SDL_min(SDL_AtomicGet(&g_ringCount), kMaxRings);
+    for (int i = 0; i < count; ++i)
+    {
+        // Taken, but not published yet.
+        LogRing* ring = static_cast<LogRing*>(SDL_AtomicGetPtr(&g_rings[i]));
+        if (ring == NULL) continue;
+
+        for (int j = 0; j < kRepeatSlots; ++j)
+        {
+            RepeatSlot& slot = ring->repeats[j];
+            if (slot.held == 0) continue;
+
+            LogRecord record = slot.record;
+            record.repeats   = slot.held - 1;
+            Format(record, out);
+        }
+        delete ring;
+    }
+    std::cout << out.str();
+    SDL_zero(g_rings);
+    SDL_TLSSet(g_ringTls, NULL, NULL);
+
+    int dropped = SDL_AtomicGet(&g_dropped);
+    if (dropped > 0) std::cout << "[warning] " << dropped << " log messages were dropped\n";
+}
+
+int GetDroppedLogs() { return SDL_AtomicGet(&g_dropped); }
+
+void Log(SDL_LogPriority priority, const char* format, const LogArg& a, const LogArg& b,
+         const LogArg& c, const LogArg& d, const LogArg& e, const LogArg& f)
+{
+    const LogArg args[kMaxArgs] = {a, b, c, d, e, f};
+    Post(priority, format, args, true);
+}
+
+static void Post(SDL_LogPriority priority, const char* format, const LogArg* args, bool limit)
+{
+    if (SDL_AtomicGet(&g_running) == 0)
+    {
+        LogRecord record;
+        record.format   = format;
+        record.priority = priority;
+        record.repeats  = 0;
+        Capture(record, args);
+
+        std::ostringstream out;
+        Format(record, out);
+        std::cout << out.str() << std::flush;
+        return;
+    }
+
+    LogRing* ring = GetRing();
+    if (ring == NULL)
+    {
+        SDL_AtomicAdd(&g_dropped, 1);
+        return;
+    }
+
+    // Hold back the same message within a second of the last one.
+    RepeatSlot* slot    = NULL;
+    int         repeats = 0;
+    if (limit)
+    {
+        Uint32 hash = HashArgs(args);
+        Uint64 now  = SDL_GetPerformanceCounter();
+        slot        = &ring->repeats[(((uintptr_t)format >> 4) ^ hash) % kRepeatSlots];
+        bool same   = slot->record.format == format && slot->hash == hash;
+        if (same && now < slot->until)
+        {
+            ++slot->held;
+            return;
+        }
+
+        // Another message's repeats would be lost with the slot.
+        if (same) repeats = slot->held;
+        else      PushHeld(ring, *slot);
+        slot->hash  = hash;
+        slot->until = now + g_repeatTicks;
+        slot->held  = 0;
+    }
+
+    LogRecord* record = BeginPush(ring);
+    if (record == NULL) return;
+
+    record->format   = format;
+    record->priority = priority;
+    record->repeats  = repeats;
+    Capture(*record, args);
+    // The slot keeps the message to write out the repeats it holds back.
+    if (slot != NULL) slot->record = *record;
+    EndPush(ring);
+}
@@ -0,0 +1,90 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <string>
+
+#include "SDL2/SDL.h"
+
+// A value handed to the logger. Numbers are captured by value and strings
+// copied into the message when it's logged, so the caller's buffers can go
+// away right after.
+class LogArg
+{
+public:
+    enum Type
+    {
+        kNone,
+        kInt,
+        kUnsigned,
+        kDouble,
+        kString
+    };
+
+    LogArg() : type_(kNone) { value_.u = 0; }
+    LogArg(int value) : type_(kInt) { value_.i = value; }
+    LogArg(unsigned value) : type_(kUnsigned) { value_.u = value; }
+    LogArg(Sint64 value) : type_(kInt) { value_.i = value; }
+    LogArg(Uint64 value) : type_(kUnsigned) { value_.u = value; }
+    LogArg(double value) : type_(kDouble) { value_.d = value; }
+    LogArg(const char* value) : type_(kString) { value_.s = value != NULL ? value : "(null)"; }
+    LogArg(const std::string& value) : type_(kString) { value_.s = value.c_str(); }
+
+    Type GetType() const { return type_; }
+    Sint64 GetInt() const { return value_.i; }
+    Uint64 GetUnsigned() const { return value_.u; }
+    double GetDouble() const { return value_.d; }
+    const char* GetString() const { return value_.s; }
+
+private:
+    Type type_;
+    union
+    {
+        Sint64      i;
+        Uint64      u;
+        double      d;
+        const char* s;
+    } value_;
+};
+
+// The asynchronous log. Every thread that logs gets a lock-free ring of its
+// own; logging copies the format pointer and the arguments into the next
+// record and moves on, and a background thread formats and writes the
+// records a batch at a time. The same message from the same thread is let
+// through once a second; the next one that gets through, or shutdown, says
+// how many were held back. SDL's own log goes through it as well, without
+// the rate limit.
+//
+// The format is a string literal with a {} for each argument. It's kept by
+// pointer; a repeat has the same format and the same arguments. Messages
+// logged while the log isn't running are written right away.
+
+// Start the background thread and take over SDL's log output. Once, before
+// the other threads start.
+bool InitLog();
+// Write out everything logged so far, give SDL its output back and stop,
+// once the other threads are done logging.
+void ShutdownLog();
+
+// The messages lost to full rings or too many threads.
+int GetDroppedLogs();
+
+// Up to six arguments.
+void Log(SDL_LogPriority priority, const char* format, const LogArg& a = LogArg(),
+         const LogArg& b = LogArg(), const LogArg& c = LogArg(), const LogArg& d = LogArg(),
+         const LogArg& e = LogArg(), const LogArg& f = LogArg());
+
+inline void LogInfo(const char* format, const LogArg& a = LogArg(), const LogArg& b = LogArg(),
+                    const LogArg& c = LogArg(), const LogArg& d = LogArg(),
+                    const LogArg& e = LogArg(), const LogArg& f = LogArg())
+{
+    Log(SDL_LOG_PRIORITY_INFO, format, a, b, c, d, e, f);
+}
+
+inline void LogError(const char* format, const LogArg& a = LogArg(), const LogArg& b = LogArg(),
+                     const LogArg& c = LogArg(), const LogArg& d = LogArg(),
+                     const LogArg& e = LogArg(), const LogArg& f = LogArg())
+{
+    Log(SDL_LOG_PRIORITY_ERROR, format, a, b, c, d, e, f);
+}
+
+#endif  // LOGGER_H_
@@ -1,96 +1,710 @@
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "asset_watcher.h"
+#include "audio_assets.h"
+#include "audio_bench.h"
+#include "animation.h"
+#include "audio_engine.h"
+#include "camera.h"
+#include "chunk_cache.h"
+#include "entity_store.h"
+#include "frame_capture.h"
+#include "input.h"
+#include "input_recorder.h"
+#include "job_system.h"
+#include "logger.h"
+#include "metrics.h"
+#include "particles.h"
+#include "spatial_hash.h"
+#include "sprite_sheet.h"
+#include "text_cache.h"
+#include "tilemap.h"
 #include "timer.h"
-#include "texture.h"
+#include "window_context.h"
 
+// The initial window size; windows can be resized.
 int g_screenWidth  = 600;
 int g_screenHeight = 480;
 
-SDL_Window*   g_window        = NULL;
-SDL_Renderer* g_renderer      = NULL;
-TTF_Font*     g_font          = NULL;
+FontAsset     g_font;
+// The text rasterized once for all windows.
+TextCache     g_textCache;
+
+// The development hot-reload service, enabled with --hot-reload.
+AssetWatcher  g_assetWatcher;
+bool          g_hotReload     = false;
+
+// The per-frame input state.
+Input         g_input;
+
+// The sound, the decoded effects within a 32 MB budget, and the track
+// streamed with --music <file>.
+const int   kSoundBudget = 32 * 1024 * 1024;
+AudioEngine g_audio;
+SoundCache  g_sounds;
+MusicStream g_music;
+std::string g_musicPath;
+
+// Measure the mixer instead of running the game with --audio-bench <n>,
+// failing when fewer than n voices mix within --audio-budget <fraction> of
+// the buffer time.
+int         g_audioBench  = 0;
+double      g_audioBudget = 0.25;
+
+// Log the input with --record <file>, or play a log back in its place with
+// --replay <file> on a clock that moves --replay-step <ms> per frame.
+InputRecorder g_recorder;
+InputReplayer g_replayer;
+std::string   g_recordPath;
+std::string   g_replayPath;
+unsigned      g_replayStep    = 16;
+
+// Dump every --capture-every <n>th frame to --capture <file> and compare
+// them with --golden <file>, allowing --tolerance <n> per channel.
+FrameCapture  g_capture;
+std::string   g_capturePath;
+std::string   g_goldenPath;
+int           g_captureEvery  = 60;
+int           g_tolerance     = 0;
+
+// Export metrics every --metrics-interval <ms> to the JSON lines, or CSV for
+// a .csv name, file --metrics <file>, and to Prometheus scrapes on the Unix
+// socket --metrics-socket <path>, a loopback TCP port on Windows.
+Metrics       g_metrics;
+std::string   g_metricsPath;
+std::string   g_metricsSocket;
+int           g_metricsInterval = 1000;
+
+// The performance HUD, toggled with F3.
+bool          g_showHud       = true;
+
+// Run without a visible window on the software renderer, with --headless.
+bool          g_headless      = false;
+
+// The worker pool shared by the subsystems.
+JobSystem     g_jobs;
+
+// Re-poll the mouse right before building the cursor and skip running
+// ahead of the render thread, enabled with --low-latency.
+bool          g_lowLatency    = false;
+
+// The --windows <n> windows, each with its own render thread, forced onto the
+// software renderer with --software. The first one is the main window.
+std::vector<WindowContext*> g_windows;
+int           g_windowCount   = 1;
+bool          g_software      = false;
+
+// The scene's --sprites <n> bouncing sprites.
+EntityStore   g_entities;
+int           g_spriteCount   = 0;
+
+// The flipbooks the sprites play: a pulsing disc and a spinning square.
+AnimationLibrary g_animations;
+ClipId        g_pulseClip     = kNoClip;
+ClipId        g_spinClip      = kNoClip;
+
+// The sprites' broadphase for culling and picking, a loose quadtree with
+// --quadtree, and the slots of the sprites left in view.
+SpatialHash   g_spatial;
+bool          g_quadtree      = false;
+std::vector<Entity> g_visible;
+std::vector<int>    g_visibleSlots;
+
+// A fountain of up to --particles <n> particles.
+ParticleEmitter g_fountain;
+int           g_particleCount = 0;
+
+// A --map <n> by n tiles map under the scene.
+Tilemap       g_tilemap;
+int           g_mapSize       = 0;
+
+// The view of the world shared by the windows: the arrow keys pan, the wheel
+// zooms and Q and E turn it. The software renderer only pans.
+Camera        g_camera;
+
+// The ids of the cached layers.
+enum Layer
+{
+    kControlsLayer
+};
 
 bool init();
 bool loadMedia();
 void close();
+int runAudioBench();
+void createAnimations();
+void spawnSprites(int count, int width, int height);
+void updateSpatial();
+void moveCamera(const InputSnapshot& input, float seconds);
+void cullSprites(FramePacket* packet, Camera& camera);
+bool createFountain(int capacity);
+void createMap(int size);
 
 int main(int argc, char* argv[])
 {
     // The main loop flag.
     bool quit = false;
 
+    // Logging goes through a background thread, SDL's as well.
+    InitLog();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--hot-reload")  g_hotReload  = true;
+        if (std::string(argv[i]) == "--software")    g_software   = true;
+        if (std::string(argv[i]) == "--low-latency") g_lowLatency = true;
+        if (std::string(argv[i]) == "--headless")    g_headless   = true;
+        if (std::string(argv[i]) == "--quadtree")    g_quadtree   = true;
+        if (i + 1 < argc)
+        {
+            if (std::string(argv[i]) == "--record")      g_recordPath = argv[++i];
+            else if (std::string(argv[i]) == "--replay") g_replayPath = argv[++i];
+            else if (std::string(argv[i]) == "--replay-step")
+            {
+                // A step of 0 would leave the clock on SDL_GetTicks().
+                int step = std::atoi(argv[++i]);
+                if (step < 1)
+                {
+                    LogError("--replay-step needs at least 1 ms, not {}", argv[i]);
+                    ShutdownLog();
+                    return 1;
+                }
+                g_replayStep = (unsigned)step;
+            }
+            else if (std::string(argv[i]) == "--capture") g_capturePath = argv[++i];
+            else if (std::string(argv[i]) == "--golden")  g_goldenPath  = argv[++i];
+            else if (std::string(argv[i]) == "--capture-every")
+                g_captureEvery = std::atoi(argv[++i]);
+            else if (std::string(argv[i]) == "--tolerance") g_tolerance = std::atoi(argv[++i]);
+            else if (std::string(argv[i]) == "--metrics") g_metricsPath = argv[++i];
+            else if (std::string(argv[i]) == "--metrics-socket") g_metricsSocket = argv[++i];
+            else if (std::string(argv[i]) == "--metrics-interval")
+                g_metricsInterval = std::atoi(argv[++i]);
+            else if (std::string(argv[i]) == "--windows")
+                g_windowCount = SDL_max(1, std::atoi(argv[++i]));
+            else if (std::string(argv[i]) == "--music") g_musicPath = argv[++i];
+            else if (std::string(argv[i]) == "--sprites")
+                g_spriteCount = SDL_max(0, std::atoi(argv[++i]));
+            else if (std::string(argv[i]) == "--particles")
+                g_particleCount = SDL_max(0, std::atoi(argv[++i]));
+            else if (std::string(argv[i]) == "--map")
+                g_mapSize = SDL_max(0, std::atoi(argv[++i]));
+            else if (std::string(argv[i]) == "--audio-bench")
+                g_audioBench = SDL_max(1, std::atoi(argv[++i]));
+            else if (std::string(argv[i]) == "--audio-budget")
+                g_audioBudget = std::atof(argv[++i]);
+        }
+    }
+    if (g_headless) g_software = true;
+    if (g_audioBench > 0)
+    {
+        int result = runAudioBench();
+        ShutdownLog();
+        return result;
+    }
+
     if (init() == false)
     {
         quit = true;
-        std::cout << "Initialize SDL Error: " << SDL_GetError() << "\n";
+        LogError("Initialize SDL Error: {}", SDL_GetError());
     }
 
     if (loadMedia() == false)
     {
         quit = true;
-        std::cout << "Load media Error: " << SDL_GetError() << "\n";
+        LogError("Load media Error: {}", SDL_GetError());
+    }
+
+    // The main window's render thread owns the capture and the render metrics.
+    RenderThread* mainThread = quit ? NULL : &g_windows[0]->GetRenderThread();
+
+    // Read frames back on the render thread.
+    bool capturing = !g_capturePath.empty() || !g_goldenPath.empty();
+    if (!quit && capturing)
+    {
+        if (g_capture.Open(g_capturePath, g_goldenPath, g_captureEvery, g_tolerance))
+            mainThread->SetCapture(&g_capture);
+        else
+        {
+            quit = true;
+            LogError("Open frame capture Error: {}", SDL_GetError());
+        }
+    }
+
+    // Register every metric before the exporter starts.
+    bool             exporting    = !g_metricsPath.empty() || !g_metricsSocket.empty();
+    MetricHistogram* buildMetric  = NULL;
+    MetricCounter*   eventsMetric = NULL;
+    MetricGauge*     uptimeMetric = NULL;
+    if (!quit && exporting)
+    {
+        mainThread->SetMetrics(&g_metrics);
+        g_audio.SetMetrics(&g_metrics);
+        buildMetric  = g_metrics.AddHistogram("main_frame_build_us",
+                                              "Time to build a frame packet in microseconds.");
+        eventsMetric = g_metrics.AddCounter("input_events_total", "Events drained.");
+        uptimeMetric = g_metrics.AddGauge("uptime_ms", "Time since the main loop started.");
+
+        bool csv = g_metricsPath.size() > 4 &&
+                   g_metricsPath.compare(g_metricsPath.size() - 4, 4, ".csv") == 0;
+        if (!g_metricsPath.empty())
+            g_metrics.SetFile(g_metricsPath, csv ? Metrics::kCsv : Metrics::kJsonLines,
+                              1024 * 1024, 3);
+        if (!g_metricsSocket.empty()) g_metrics.SetSocket(g_metricsSocket);
+
+        if (!g_metrics.Start(g_metricsInterval))
+        {
+            quit = true;
+            LogError("Start metrics Error: {}", SDL_GetError());
+        }
     }
 
-    // SDL event handler.
-    SDL_Event e;
+    // Sound is optional, carry on without it.
+    if (!quit)
+    {
+        if (SDL_InitSubSystem(SDL_INIT_AUDIO) == 0 && g_audio.Open(48000, 512) &&
+            g_sounds.Init(&g_jobs, kSoundBudget))
+        {
+            g_sounds.Preload("click.wav");
+            if (!g_musicPath.empty())
+            {
+                if (g_music.Play(g_musicPath, true)) g_music.SetVolume(0.5f);
+                else LogError("Play music Error: {}", SDL_GetError());
+            }
+        }
+        else LogError("Open audio Error: {}", SDL_GetError());
+    }
+
+    // Hand every renderer over to its own thread.
+    for (size_t i = 0; i < g_windows.size() && !quit; ++i)
+    {
+        if (!g_windows[i]->Start(g_software, &g_textCache, &g_jobs))
+        {
+            quit = true;
+            LogError("Start render thread Error: {}", SDL_GetError());
+        }
+        // Captures need every frame presented, none replaced by a newer one.
+        if (g_lowLatency || capturing) g_windows[i]->GetRenderThread().SetMaxFramesAhead(0);
+    }
+
+    if (!quit && !g_recordPath.empty())
+    {
+        if (g_recorder.Open(g_recordPath)) g_input.SetRecorder(&g_recorder);
+        else LogError("Open input log Error: {}", SDL_GetError());
+    }
+    if (!quit && !g_replayPath.empty())
+    {
+        if (g_replayer.Open(g_replayPath)) Timer::UseFixedClock(g_replayStep);
+        else
+        {
+            quit = true;
+            LogError("Open input log Error: {}", SDL_GetError());
+        }
+    }
+
+    if (!quit) createAnimations();
+    if (!quit) spawnSprites(g_spriteCount, g_windows[0]->GetWidth(), g_windows[0]->GetHeight());
+    // Cells of a few sprites each.
+    g_spatial.Create(g_quadtree ? SpatialHash::kLooseQuadtree : SpatialHash::kGrid,
+                     4.f * SpriteSheet::kSpriteSize);
+    if (!quit && g_mapSize > 0) createMap(g_mapSize);
+    // Starting out on the sprites' area, the main window.
+    if (!quit)
+        g_camera.SetPosition(g_windows[0]->GetWidth() / 2.f, g_windows[0]->GetHeight() / 2.f);
+    if (!quit && g_particleCount > 0 && !createFountain(g_particleCount))
+    {
+        quit = true;
+        LogError("Create particles Error: {}", SDL_GetError());
+    }
 
     // The fps text color;
     SDL_Color fpsColor = {0, 0, 0, 255};
+    // The cursor color.
+    SDL_Color cursorColor = {0xE0, 0x30, 0x30, 0xC0};
+    // The controls panel colors and area.
+    SDL_Color panelColor  = {0xF0, 0xF0, 0xF0, 0xD0};
+    SDL_Color borderColor = {0x60, 0x60, 0x60, 0xFF};
     // The text stream in memory.
     std::stringstream fpsText;
-    // The fps timer.
+    // The fps timer, and its time at the last frame.
     Timer fpsTimer;
-    // The fps timer texture.
-    Texture fpsTexture;
-    // Start counting frames per second.
-    int countFrames = 0;
     fpsTimer.Start();
+    Uint32 lastTicks = 0;
+    // The wall time of a replay.
+    Uint64 replayStart = SDL_GetPerformanceCounter();
+    // The packet of every window.
+    std::vector<FramePacket*> packets(g_windows.size());
 
     // The main loop.
     while (!quit)
     {
-        while (SDL_PollEvent(&e) != 0)
+        // Wait until every render thread has caught up far enough.
+        for (size_t i = 0; i < g_windows.size(); ++i)
+        {
+            RenderThread& renderThread = g_windows[i]->GetRenderThread();
+            packets[i]                 = renderThread.BeginFrame();
+            // Nothing gets presented after a render thread gave up.
+            if (!renderThread.IsRunning()) quit = true;
+        }
+        Uint64 buildStart = SDL_GetPerformanceCounter();
+
+        // Feed the recorded input of this frame in place of the live one.
+        if (g_replayer.IsOpen())
+        {
+            Timer::AdvanceFixedClock();
+            if (!g_replayer.PushFrame(g_input.GetFrame())) quit = true;
+        }
+
+        const InputSnapshot& input = g_input.Update();
+        if (input.quit) quit = true;
+        if (input.WasKeyPressed(SDL_SCANCODE_F3)) g_showHud = !g_showHud;
+        if (input.resized)
+            for (size_t i = 0; i < g_windows.size(); ++i) g_windows[i]->UpdateSize();
+        // Move the sprites around the main window, by at most a tenth of a
+        // second after a stall.
+        Uint32 ticks   = fpsTimer.GetTicks();
+        float  seconds = SDL_min((ticks - lastTicks) / 1000.f, 0.1f);
+        lastTicks      = ticks;
+        g_entities.Integrate(seconds, (float)g_windows[0]->GetWidth(),
+                             (float)g_windows[0]->GetHeight(), &g_jobs);
+        EntityView entities = g_entities.GetView();
+        g_animations.Animate(entities.clips, entities.clipTimes, entities.sprites,
+                             entities.count, seconds, &g_jobs);
+        updateSpatial();
+        // The fountain stays at the bottom center.
+        g_fountain.SetPosition(g_windows[0]->GetWidth() / 2.f, (float)g_windows[0]->GetHeight());
+        g_fountain.Update(seconds, &g_jobs);
+        moveCamera(input, seconds);
+
+        // Click where the mouse is, panned across the main window. Pop the
+        // topmost sprite under it, or else paint the tile under it, which
+        // renders only that chunk again.
+        if (input.buttonsPressed != 0)
         {
-            if (e.type == SDL_QUIT) quit = true;
+            g_audio.Play(g_sounds.Get("click.wav"), 0.8f,
+                         input.mouseX * 2.f / SDL_max(1, g_windows[0]->GetWidth()) - 1.f);
+
+            SDL_FRect point = {0.f, 0.f, 0.f, 0.f};
+            g_camera.ScreenToWorld((float)input.mouseX, (float)input.mouseY, point.x, point.y);
+            g_visible.clear();
+            g_spatial.Query(point, g_visible, NULL);
+            Entity picked = 0;
+            for (size_t i = 0; i < g_visible.size(); ++i)
+                if (picked == 0 || g_entities.GetSlot(g_visible[i]) > g_entities.GetSlot(picked))
+                    picked = g_visible[i];
+
+            if (picked != 0)
+            {
+                g_spatial.Remove(picked);
+                g_entities.Destroy(picked);
+            }
+            else
+            {
+                int   tileX = (int)SDL_floorf(point.x / TileChunk::kTileSize);
+                int   tileY = (int)SDL_floorf(point.y / TileChunk::kTileSize);
+                Uint8 tile  = g_tilemap.GetTile(tileX, tileY);
+                g_tilemap.SetTile(tileX, tileY, tile % ChunkCache::kTileCount + 1);
+            }
         }
 
-        // Calculate and correct fps.
-        float avgFps = countFrames / (fpsTimer.GetTicks() / 1000.f);
-        if (avgFps > 2000000) avgFps = 0;
+        for (size_t i = 0; i < g_windows.size(); ++i)
+        {
+            RenderThread& renderThread = g_windows[i]->GetRenderThread();
+            FramePacket*  packet       = packets[i];
+            packet->width              = g_windows[i]->GetWidth();
+            packet->height             = g_windows[i]->GetHeight();
+
+            // The map goes under everything else, then the sprites in view,
+            // all seen through the camera. Each window gets a copy at its own
+            // size, so clamping to it never moves the main window's view.
+            Camera camera = g_camera;
+            camera.SetViewport(packet->width, packet->height);
+            g_tilemap.Draw(packet, camera);
+            int firstSprite = (int)packet->sprites.x.size();
+            cullSprites(packet, camera);
+            g_fountain.Draw(packet);
+            camera.Apply(packet, firstSprite);
+
+            // Calculate and correct fps from the frames actually presented.
+            float avgFps = renderThread.GetPresentedFrames() / (fpsTimer.GetTicks() / 1000.f);
+            if (avgFps > 2000000) avgFps = 0;
+
+            fpsText.str("");
+            fpsText << "平均FPS为：" << avgFps;
+            packet->AddText(fpsText.str(), fpsColor, 10, 10);
 
-        fpsText.str("");
-        fpsText << "平均FPS为：" << avgFps;
-        if (!fpsTexture.LoadFromRenderedText(g_renderer, g_font, fpsText.str(), fpsColor))
-                std::cout << "Unable to render fps texture!\n";
+            // The latency depends on the wall clock, keep it out of captures.
+            if (!capturing)
+            {
+                fpsText.str("");
+                fpsText << "输入延迟：" << renderThread.GetInputLatency() / 1000.f
+                        << " ms (平均 " << renderThread.GetAverageInputLatency() / 1000.f
+                        << " ms)";
+                packet->AddText(fpsText.str(), fpsColor, 10, 50);
+            }
 
-        SDL_SetRenderDrawColor(g_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-        SDL_RenderClear(g_renderer);
+            // The controls panel sticks to the right edge and never changes,
+            // it's rendered once into its layer.
+            SDL_Rect panel = {packet->width - 190, 90, 180, 84};
+            int      layer = packet->BeginLayer(kControlsLayer, 0, panel);
+            packet->AddFillRect(panel, panelColor);
+            SDL_Rect border[4] = {{panel.x, panel.y, panel.w, 2},
+                                  {panel.x, panel.y + panel.h - 2, panel.w, 2},
+                                  {panel.x, panel.y, 2, panel.h},
+                                  {panel.x + panel.w - 2, panel.y, 2, panel.h}};
+            for (int j = 0; j < 4; ++j) packet->AddFillRect(border[j], borderColor);
+            packet->AddText("按键", fpsColor, panel.x + 12, panel.y + 4);
+            packet->AddText("F3：性能面板", fpsColor, panel.x + 12, panel.y + 42);
+            packet->EndLayer(layer);
 
-        fpsTexture.Render(g_renderer, 10, 10);
+            // Latch the mouse as late as possible before drawing the cursor,
+            // which only the main window shows. A replay already pushed all
+            // of the frame's input.
+            if (g_lowLatency && i == 0)
+            {
+                if (!g_replayer.IsOpen()) g_input.LatchLate();
+                SDL_Rect cursor = {input.mouseX - 4, input.mouseY - 4, 8, 8};
+                packet->AddFillRect(cursor, cursorColor);
+            }
+            packet->inputTime  = input.firstEventTime;
+            packet->eventCount = input.eventCount;
+            packet->showHud    = g_showHud;
+        }
+
+        if (exporting)
+        {
+            buildMetric->Record((Uint32)((SDL_GetPerformanceCounter() - buildStart) * 1000000 /
+                                         SDL_GetPerformanceFrequency()));
+            eventsMetric->Add(input.eventCount);
+            uptimeMetric->Set((int)fpsTimer.GetTicks());
+        }
+
+        for (size_t i = 0; i < g_windows.size(); ++i) g_windows[i]->GetRenderThread().SubmitFrame();
+    }
 
-        SDL_RenderPresent(g_renderer);
-        ++countFrames;
+    if (g_replayer.IsOpen())
+    {
+        double seconds = (double)(SDL_GetPerformanceCounter() - replayStart) /
+                         SDL_GetPerformanceFrequency();
+        LogInfo("Replayed {} frames in {} s", g_input.GetFrame(), seconds);
     }
 
     close();
-    return 0;
+
+    int result = 0;
+    if (capturing)
+    {
+        LogInfo("Captured {} frames, {} of {} differ from the golden images",
+                g_capture.GetCapturedFrames(), g_capture.GetFailedFrames(),
+                g_capture.GetComparedFrames());
+        if (g_capture.GetFailedFrames() > 0) result = 1;
+    }
+
+    // Once every other thread is gone.
+    ShutdownLog();
+    return result;
+}
+
+int runAudioBench()
+{
+    // No sound card needed; SDL_AUDIODRIVER=disk works too.
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_AUDIO) != 0 || !g_audio.Open(48000, 512))
+    {
+        LogError("Open audio Error: {}", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    // The engine lets go of the bench's noise as it closes.
+    AudioBench bench;
+    bool       ran = bench.Run(&g_audio, g_audioBudget, 500);
+    g_audio.Close();
+    SDL_Quit();
+
+    return ran && bench.GetMaxVoices() >= g_audioBench ? 0 : 1;
+}
+
+void spawnSprites(int count, int width, int height)
+{
+    // The same scene every run, so captures stay comparable.
+    Uint32 seed = 1;
+    for (int i = 0; i < count; ++i)
+    {
+        float values[5];
+        for (int j = 0; j < 5; ++j)
+        {
+            seed      = seed * 1664525 + 1013904223;
+            values[j] = (seed >> 8) / 16777216.f;
+        }
+
+        SDL_Color color  = {(Uint8)(values[4] * 255), (Uint8)(255 - values[4] * 255), 0xC0, 0xC0};
+        Entity    entity = g_entities.Create(values[0] * width, values[1] * height,
+                                             (values[2] - 0.5f) * 200.f,
+                                             (values[3] - 0.5f) * 200.f,
+                                             (Uint8)(i % SpriteSheet::kShapeCount), color);
+
+        // Every other one animates, out of step with the rest.
+        ClipId clip = i % 4 == 1 ? g_pulseClip : i % 4 == 3 ? g_spinClip : kNoClip;
+        if (clip != kNoClip)
+            g_entities.SetAnimation(entity, clip, values[4] * g_animations.GetLength(clip));
+    }
+}
+
+void createAnimations()
+{
+    // Out and back in, without repeating the ends.
+    const int      kPulseLength = 2 * SpriteSheet::kPulseFrames - 2;
+    AnimationFrame pulse[kPulseLength];
+    for (int i = 0; i < kPulseLength; ++i)
+    {
+        int            step  = i < SpriteSheet::kPulseFrames ? i : kPulseLength - i;
+        AnimationFrame frame = {(Uint8)(SpriteSheet::kPulse + step), 0.08f};
+        pulse[i]             = frame;
+    }
+    g_pulseClip = g_animations.AddClip(pulse, kPulseLength, true);
+
+    AnimationFrame spin[SpriteSheet::kSpinFrames];
+    for (int i = 0; i < SpriteSheet::kSpinFrames; ++i)
+    {
+        AnimationFrame frame = {(Uint8)(SpriteSheet::kSpin + i), 0.06f};
+        spin[i]              = frame;
+    }
+    g_spinClip = g_animations.AddClip(spin, SpriteSheet::kSpinFrames, true);
+}
+
+void updateSpatial()
+{
+    // Only the sprites that changed cells touch the table.
+    EntityView view = g_entities.GetView();
+    float      half = SpriteSheet::kSpriteSize / 2.f;
+    for (int i = 0; i < view.count; ++i)
+    {
+        SDL_FRect bounds = {view.x[i] - half, view.y[i] - half, 2 * half, 2 * half};
+        g_spatial.Update(view.entities[i], bounds);
+    }
+}
+
+void moveCamera(const InputSnapshot& input, float seconds)
+{
+    // The main window's view, which the mouse is in.
+    g_camera.SetViewport(g_windows[0]->GetWidth(), g_windows[0]->GetHeight());
+
+    // A steady speed on screen at any zoom.
+    float step = 400.f * seconds / g_camera.GetZoom();
+    float dx   = 0.f;
+    float dy   = 0.f;
+    if (input.IsKeyDown(SDL_SCANCODE_LEFT))  dx -= step;
+    if (input.IsKeyDown(SDL_SCANCODE_RIGHT)) dx += step;
+    if (input.IsKeyDown(SDL_SCANCODE_UP))    dy -= step;
+    if (input.IsKeyDown(SDL_SCANCODE_DOWN))  dy += step;
+    g_camera.Move(dx, dy);
+    if (g_software) return;
+
+    if (input.wheelY != 0) g_camera.SetZoom(g_camera.GetZoom() * SDL_powf(1.1f, input.wheelY));
+    float turn = 0.f;
+    if (input.IsKeyDown(SDL_SCANCODE_Q)) turn -= 90.f * seconds;
+    if (input.IsKeyDown(SDL_SCANCODE_E)) turn += 90.f * seconds;
+    if (turn != 0.f) g_camera.SetRotation(g_camera.GetRotation() + turn);
+}
+
+void cullSprites(FramePacket* packet, Camera& camera)
+{
+    g_visible.clear();
+    g_spatial.Query(camera.GetVisibleRect(), g_visible, &g_jobs);
+
+    // Back in store order, so overlapping sprites don't flicker.
+    g_visibleSlots.resize(g_visible.size());
+    for (size_t i = 0; i < g_visible.size(); ++i)
+        g_visibleSlots[i] = g_entities.GetSlot(g_visible[i]);
+    std::sort(g_visibleSlots.begin(), g_visibleSlots.end());
+
+    EntityView view = g_entities.GetView();
+    packet->AddSprites(view.x, view.y, view.sprites, view.colors,
+                       g_visibleSlots.empty() ? NULL : &g_visibleSlots[0],
+                       (int)g_visibleSlots.size());
+}
+
+bool createFountain(int capacity)
+{
+    // Up and out, falling back under gravity, fading from yellow to red. A
+    // particle lives 2 seconds on average, so the rate keeps the pool full.
+    ParticleSettings settings;
+    SDL_zero(settings);
+    settings.rate       = capacity / 2.f;
+    settings.angle      = -(float)M_PI / 2;
+    settings.spread     = 0.35f;
+    settings.speedMin   = 250.f;
+    settings.speedMax   = 450.f;
+    settings.lifeMin    = 1.5f;
+    settings.lifeMax    = 2.5f;
+    settings.forceY     = 300.f;
+    settings.drag       = 0.2f;
+    settings.colorCount = 3;
+    settings.sprite     = SpriteSheet::kDisc;
+    SDL_Color colors[3] = {{0xFF, 0xF0, 0x60, 0xFF}, {0xFF, 0x90, 0x20, 0xC0},
+                           {0xD0, 0x20, 0x10, 0x00}};
+    for (int i = 0; i < 3; ++i) settings.colors[i] = colors[i];
+
+    return g_fountain.Create(settings, capacity);
+}
+
+void createMap(int size)
+{
+    // Bands of terrain from a few overlapping waves, the same every run.
+    g_tilemap.Create(size, size);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            float height = SDL_sinf(x * 0.11f) + SDL_sinf(y * 0.07f) +
+                           0.5f * SDL_sinf((x + y) * 0.23f);
+            int   tile   = (int)((height + 2.5f) * ChunkCache::kTileCount / 5.f);
+            g_tilemap.SetTile(x, y, (Uint8)SDL_max(1, SDL_min(tile + 1, ChunkCache::kTileCount)));
+        }
+    }
+
+    // The camera stays over the map.
+    SDL_FRect bounds = {0.f, 0.f, (float)(g_tilemap.GetWidth() * TileChunk::kTileSize),
+                        (float)(g_tilemap.GetHeight() * TileChunk::kTileSize)};
+    g_camera.SetBounds(bounds);
 }
 
 bool init()
 {
+    // Render into an invisible window, and play into nothing.
+    if (g_headless)
+    {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
     // Initialize SDL subsystem.
     if (SDL_Init(SDL_INIT_VIDEO) != 0) return false;
 
-    // Create SDL window.
-    g_window = SDL_CreateWindow("SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                              g_screenWidth, g_screenHeight, SDL_WINDOW_SHOWN);
-    if (g_window == NULL) return false;
+    // Switch off the events nobody reads.
+    g_input.Init();
+
+    // Create the SDL windows, the extra ones cascading from the main one.
+    for (int i = 0; i < g_windowCount; ++i)
+    {
+        std::stringstream title;
+        title << "SDL Tutorial";
+        if (i > 0) title << " " << i + 1;
+
+        int            position = i == 0 ? SDL_WINDOWPOS_UNDEFINED : 32 + 32 * i;
+        WindowContext* window   = new WindowContext;
+        g_windows.push_back(window);
+        if (!window->Create(title.str(), position, position, g_screenWidth, g_screenHeight))
+            return false;
+    }
 
-    // Create SDL renderer.
-    g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_ACCELERATED);
-    if (g_renderer == NULL) return false;
+    // Start the worker pool, with a deque for every window's render thread.
+    if (!g_jobs.Init(-1, g_windowCount)) return false;
 
     // Initialize SDL ttf.
     if (TTF_Init() == -1) return false;
@@ -102,8 +716,17 @@ bool init()
 bool loadMedia()
 {
     // Load font.
-    g_font = TTF_OpenFont("msyh.ttc", 28);
-    if (g_font == NULL) return false;
+    if (!g_font.Load("msyh.ttc", 28)) return false;
+
+    // Watch the assets for changes.
+    if (g_hotReload)
+    {
+        g_font.Watch(g_assetWatcher);
+        if (!g_assetWatcher.Start()) return false;
+    }
+
+    // Rasterize the text for every window.
+    if (!g_textCache.Init(&g_font, g_hotReload ? &g_assetWatcher : NULL, &g_jobs)) return false;
 
     // Everthing is OK.
     return true;
@@ -111,13 +734,26 @@ bool loadMedia()
 
 void close()
 {
-    SDL_DestroyRenderer(g_renderer);
-    SDL_DestroyWindow(g_window);
-    TTF_CloseFont(g_font);
+    // The render threads destroy their renderers on their way out.
+    for (size_t i = 0; i < g_windows.size(); ++i) g_windows[i]->Stop();
+    g_music.Stop();
+    g_audio.Close();
+    // The sounds wait for their decodes on the jobs.
+    g_sounds.Free();
+    g_recorder.Close();
+    g_replayer.Close();
+    g_capture.Close();
+    g_metrics.Stop();
+    g_assetWatcher.Stop();
+    // The text cache waits for its rasterizations on the jobs.
+    g_textCache.Free();
+    g_jobs.Shutdown();
 
-    g_renderer       = NULL;
-    g_window         = NULL;
-    g_font           = NULL;
+    for (size_t i = 0; i < g_windows.size(); ++i) delete g_windows[i];
+    g_windows.clear();
+    g_fountain.Free();
+    g_tilemap.Free();
+    g_font.Free();
 
     TTF_Quit();
     SDL_Quit();
@@ -0,0 +1,534 @@
+#include "metrics.h"
+
+#include <cstdio>
+#include <sstream>
+
+#include "SDL2/SDL_bits.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define METRICS_UNIX_SOCKET 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define METRICS_WINSOCK 1
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#endif
+
+// How long the exporter sleeps at most between checks for quitting.
+static const int kMaxWaitMs = 100;
+
+MetricHistogram::MetricHistogram()
+{
+    for (int i = 0; i < kBuckets; ++i) SDL_AtomicSet(&buckets_[i], 0);
+}
+
+int MetricHistogram::BucketOf(Uint32 value)
+{
+    if (value < (Uint32)kSubBuckets) return (int)value;
+
+    int exponent = SDL_MostSignificantBitIndex32(value);
+    return (exponent - kSubBits + 1) * kSubBuckets +
+           (int)((value >> (exponent - kSubBits)) & (kSubBuckets - 1));
+}
+
+Uint32 MetricHistogram::BucketLow(int bucket)
+{
+    if (bucket < kSubBuckets) return (Uint32)bucket;
+
+    int exponent = bucket / kSubBuckets + kSubBits - 1;
+    return (Uint32)(kSubBuckets + bucket % kSubBuckets) << (exponent - kSubBits);
+}
+
+Uint32 GetHistogramPercentile(const std::vector<Uint32>& buckets, int percent)
+{
+    Uint64 count = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) count += buckets[i];
+    if (count == 0) return 0;
+
+    // The rank of the value asked for, at least the first.
+    Uint64 rank = SDL_max((count * percent + 99) / 100, (Uint64)1);
+    Uint64 seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank) return MetricHistogram::BucketLow((int)i);
+    }
+
+    return 0;
+}
+
+Metrics::Metrics()
+    : startTime_(0), format_(kJsonLines), maxBytes_(0), keep_(0), file_(NULL), socket_(-1),
+      intervalMs_(1000), thread_(NULL)
+{
+    SDL_AtomicSet(&quit_, 0);
+}
+
+Metrics::~Metrics()
+{
+    Stop();
+
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        delete entries_[i].counter;
+        delete entries_[i].gauge;
+        delete entries_[i].histogram;
+    }
+}
+
+Metrics::Entry& Metrics::Add(Entry::Type type, const std::string& name, const std::string& help)
+{
+    Entry entry;
+    entry.type      = type;
+    entry.name      = name;
+    entry.help      = help;
+    entry.counter   = NULL;
+    entry.gauge     = NULL;
+    entry.histogram = NULL;
+    entry.last      = 0;
+    entry.total     = 0;
+
+    entries_.push_back(entry);
+    return entries_.back();
+}
+
+MetricCounter* Metrics::AddCounter(const std::string& name, const std::string& help)
+{
+    Entry& entry = Add(Entry::kCounter, name, help);
+    entry.counter = new MetricCounter;
+    return entry.counter;
+}
+
+MetricGauge* Metrics::AddGauge(const std::string& name, const std::string& help)
+{
+    Entry& entry = Add(Entry::kGauge, name, help);
+    entry.gauge = new MetricGauge;
+    return entry.gauge;
+}
+
+MetricHistogram* Metrics::AddHistogram(const std::string& name, const std::string& help)
+{
+    Entry& entry = Add(Entry::kHistogram, name, help);
+    entry.histogram = new MetricHistogram;
+    entry.lastBuckets.assign(MetricHistogram::kBuckets, 0);
+    entry.totalBuckets.assign(MetricHistogram::kBuckets, 0);
+    entry.newBuckets.assign(MetricHistogram::kBuckets, 0);
+    return entry.histogram;
+}
+
+void Metrics::SetFile(const std::string& path, Format format, int maxBytes, int keep)
+{
+    filePath_ = path;
+    format_   = format;
+    maxBytes_ = maxBytes;
+    keep_     = keep;
+}
+
+void Metrics::SetSocket(const std::string& path) { socketPath_ = path; }
+
+bool Metrics::Start(int intervalMs)
+{
+    if (thread_ != NULL) return true;
+
+    intervalMs_ = SDL_max(intervalMs, 1);
+    startTime_  = SDL_GetPerformanceCounter();
+
+    if (!filePath_.empty())
+    {
+        file_ = SDL_RWFromFile(filePath_.c_str(), "ab");
+        if (file_ == NULL) return false;
+    }
+    if (!socketPath_.empty() && !OpenSocket()) return false;
+
+    SDL_AtomicSet(&quit_, 0);
+    thread_ = SDL_CreateThread(ThreadMain, "Metrics", this);
+    return thread_ != NULL;
+}
+
+void Metrics::Stop()
+{
+    if (thread_ != NULL)
+    {
+        SDL_AtomicSet(&quit_, 1);
+        SDL_WaitThread(thread_, NULL);
+        thread_ = NULL;
+
+        // The last partial interval.
+        Collect();
+        if (file_ != NULL) WriteFile();
+    }
+
+    if (file_ != NULL) SDL_RWclose(file_);
+    file_ = NULL;
+    CloseSocket();
+}
+
+int SDLCALL Metrics::ThreadMain(void* data)
+{
+    static_cast<Metrics*>(data)->Run();
+    return 0;
+}
+
+void Metrics::Run()
+{
+    Uint32 next = SDL_GetTicks() + intervalMs_;
+    while (SDL_AtomicGet(&quit_) == 0)
+    {
+        int wait = (int)(next - SDL_GetTicks());
+        if (wait > 0)
+        {
+            wait = SDL_min(wait, kMaxWaitMs);
+            if (socket_ >= 0) ServeSocket(wait);
+            else              SDL_Delay(wait);
+            continue;
+        }
+
+        next += intervalMs_;
+        Collect();
+        if (file_ != NULL) WriteFile();
+    }
+}
+
+void Metrics::Collect()
+{
+    // The metrics are only read; the frame never waits on the exporter.
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        Entry& entry = entries_[i];
+        switch (entry.type)
+        {
+        case Entry::kCounter:
+        {
+            Uint32 value = (Uint32)SDL_AtomicGet(&entry.counter->value_);
+            entry.total += value - entry.last;
+            entry.last   = value;
+            break;
+        }
+
+        case Entry::kGauge:
+            entry.last = (Uint32)SDL_AtomicGet(&entry.gauge->value_);
+            break;
+
+        case Entry::kHistogram:
+            for (int b = 0; b < MetricHistogram::kBuckets; ++b)
+            {
+                Uint32 value = (Uint32)SDL_AtomicGet(&entry.histogram->buckets_[b]);
+                Uint32 delta = value - entry.lastBuckets[b];
+                entry.lastBuckets[b]   = value;
+                entry.totalBuckets[b] += delta;
+                entry.newBuckets[b]   += delta;
+            }
+            break;
+        }
+    }
+}
+
+void Metrics::WriteFile()
+{
+    std::stringstream out;
+    Uint64 time = (SDL_GetPerformanceCounter() - startTime_) * 1000 / SDL_GetPerformanceFrequency();
+
+    if (format_ == kCsv && SDL_RWtell(file_) == 0) out << "time_ms,name,value\n";
+    if (format_ == kJsonLines) out << "{\"time_ms\":" << time;
+
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        Entry& entry = entries_[i];
+        if (entry.type != Entry::kHistogram)
+        {
+            Sint64 value = entry.type == Entry::kCounter ? (Sint64)entry.total
+                                                         : (Sint64)(int)entry.last;
+            if (format_ == kJsonLines) out << ",\"" << entry.name << "\":" << value;
+            else out << time << "," << entry.name << "," << value << "\n";
+            continue;
+        }
+
+        // Histograms report the interval since the last line.
+        Uint64 count = 0;
+        for (size_t b = 0; b < entry.newBuckets.size(); ++b) count += entry.newBuckets[b];
+
+        static const int   kPercents[] = {50, 95, 99, 100};
+        static const char* kNames[]    = {"p50", "p95", "p99", "max"};
+        if (format_ == kJsonLines)
+        {
+            out << ",\"" << entry.name << "\":{\"count\":" << count;
+            for (int p = 0; p < 4; ++p)
+                out << ",\"" << kNames[p]
+                    << "\":" << GetHistogramPercentile(entry.newBuckets, kPercents[p]);
+            out << "}";
+        }
+        else
+        {
+            out << time << "," << entry.name << "_count," << count << "\n";
+            for (int p = 0; p < 4; ++p)
+                out << time << "," << entry.name << "_" << kNames[p] << ","
+                    << GetHistogramPercentile(entry.newBuckets, kPercents[p]) << "\n";
+        }
+
+        entry.newBuckets.assign(entry.newBuckets.size(), 0);
+    }
+
+    if (format_ == kJsonLines) out << "}\n";
+
+    line_ = out.str();
+    SDL_RWwrite(file_, line_.data(), 1, line_.size());
+
+    if (maxBytes_ > 0 && SDL_RWtell(file_) >= maxBytes_) Rotate();
+}
+
+void Metrics::Rotate()
+{
+    SDL_RWclose(file_);
+
+    // path.<keep> drops off, the others move up by one.
+    std::stringstream name;
+    name << filePath_ << "." << keep_;
+    std::remove(name.str().c_str());
+    for (int i = keep_ - 1; i >= 0; --i)
+    {
+        std::stringstream from, to;
+        from << filePath_;
+        if (i > 0) from << "." << i;
+        to << filePath_ << "." << i + 1;
+        std::rename(from.str().c_str(), to.str().c_str());
+    }
+
+    file_ = SDL_RWFromFile(filePath_.c_str(), "wb");
+}
+
+void Metrics::WritePrometheus(std::string& body)
+{
+    std::stringstream out;
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        Entry& entry = entries_[i];
+        out << "# HELP " << entry.name << " " << entry.help << "\n";
+
+        if (entry.type == Entry::kCounter)
+        {
+            out << "# TYPE " << entry.name << " counter\n" << entry.name << " " << entry.total << "\n";
+            continue;
+        }
+        if (entry.type == Entry::kGauge)
+        {
+            out << "# TYPE " << entry.name << " gauge\n"
+                << entry.name << " " << (int)entry.last << "\n";
+            continue;
+        }
+
+        // One cumulative bucket per power of two, up to the highest value
+        // seen. The sum is estimated from the bucket bounds.
+        int top = MetricHistogram::kBuckets - 1;
+        while (top > 0 && entry.totalBuckets[top] == 0) --top;
+
+        out << "# TYPE " << entry.name << " histogram\n";
+        Uint64 count = 0;
+        Uint64 sum   = 0;
+        for (int b = 0; b < MetricHistogram::kBuckets; ++b)
+        {
+            count += entry.totalBuckets[b];
+            sum   += entry.totalBuckets[b] * MetricHistogram::BucketLow(b);
+
+            bool powerEnd = (b + 1) % MetricHistogram::kSubBuckets == 0;
+            if (powerEnd && b <= top + MetricHistogram::kSubBuckets &&
+                b + 1 < MetricHistogram::kBuckets)
+                out << entry.name << "_bucket{le=\"" << MetricHistogram::BucketLow(b + 1) - 1
+                    << "\"} " << count << "\n";
+        }
+        out << entry.name << "_bucket{le=\"+Inf\"} " << count << "\n"
+            << entry.name << "_sum " << sum << "\n"
+            << entry.name << "_count " << count << "\n";
+    }
+
+    body = out.str();
+}
+
+void Metrics::WriteResponse(std::string& text)
+{
+    Collect();
+    std::string body;
+    WritePrometheus(body);
+
+    std::stringstream response;
+    response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    text = response.str();
+}
+
+#ifdef METRICS_UNIX_SOCKET
+bool Metrics::OpenSocket()
+{
+    sockaddr_un address;
+    SDL_zero(address);
+    address.sun_family = AF_UNIX;
+    if (socketPath_.size() >= sizeof(address.sun_path))
+    {
+        SDL_SetError("The metrics socket path %s is too long", socketPath_.c_str());
+        return false;
+    }
+    SDL_strlcpy(address.sun_path, socketPath_.c_str(), sizeof(address.sun_path));
+
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_ < 0) return false;
+
+    // A stale socket of an earlier run is in the way.
+    unlink(socketPath_.c_str());
+    if (bind(socket_, (sockaddr*)&address, sizeof(address)) != 0 || listen(socket_, 4) != 0)
+    {
+        SDL_SetError("Unable to listen on %s", socketPath_.c_str());
+        CloseSocket();
+        return false;
+    }
+
+    fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void Metrics::ServeSocket(int waitMs)
+{
+    pollfd listening = {socket_, POLLIN, 0};
+    if (poll(&listening, 1, waitMs) <= 0) return;
+
+    int client = accept(socket_, NULL, NULL);
+    if (client < 0) return;
+
+    // Swallow the request, whatever arrives in time; every request gets the
+    // metrics.
+    pollfd request = {client, POLLIN, 0};
+    char   buffer[1024];
+    while (poll(&request, 1, kMaxWaitMs) > 0 &&
+           read(client, buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer))
+    {
+    }
+
+    std::string text;
+    WriteResponse(text);
+
+    for (size_t sent = 0; sent < text.size();)
+    {
+        ssize_t written = write(client, text.data() + sent, text.size() - sent);
+        if (written <= 0) break;
+        sent += (size_t)written;
+    }
+    close(client);
+}
+
+void Metrics::CloseSocket()
+{
+    if (socket_ < 0) return;
+
+    close(socket_);
+    unlink(socketPath_.c_str());
+    socket_ = -1;
+}
+#elif defined(METRICS_WINSOCK)
+// No Unix sockets here; the path is a port on the loopback interface.
+bool Metrics::OpenSocket()
+{
+    int port = SDL_atoi(socketPath_.c_str());
+    if (port <= 0 || port > 65535)
+    {
+        SDL_SetError("The metrics socket %s isn't a port number", socketPath_.c_str());
+        return false;
+    }
+
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        SDL_SetError("Unable to start Winsock");
+        return false;
+    }
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET)
+    {
+        SDL_SetError("Unable to create the metrics socket");
+        WSACleanup();
+        return false;
+    }
+    // Only the low 32 bits of a socket handle are ever used.
+    socket_ = (int)listener;
+
+    sockaddr_in address;
+    SDL_zero(address);
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons((u_short)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0)
+    {
+        SDL_SetError("Unable to listen on port %d", port);
+        CloseSocket();
+        return false;
+    }
+
+    u_long nonBlocking = 1;
+    ioctlsocket(listener, FIONBIO, &nonBlocking);
+    return true;
+}
+
+void Metrics::ServeSocket(int waitMs)
+{
+    SOCKET  listener = (SOCKET)socket_;
+    fd_set  listening;
+    timeval wait = {waitMs / 1000, (waitMs % 1000) * 1000};
+    FD_ZERO(&listening);
+    FD_SET(listener, &listening);
+    if (select(0, &listening, NULL, NULL, &wait) <= 0) return;
+
+    SOCKET client = accept(listener, NULL, NULL);
+    if (client == INVALID_SOCKET) return;
+
+    // The client inherits non-blocking from the listener; block on the send.
+    u_long blocking = 0;
+    ioctlsocket(client, FIONBIO, &blocking);
+
+    // Swallow the request, whatever arrives in time; every request gets the
+    // metrics.
+    char buffer[1024];
+    for (;;)
+    {
+        fd_set  request;
+        timeval requestWait = {0, kMaxWaitMs * 1000};
+        FD_ZERO(&request);
+        FD_SET(client, &request);
+        if (select(0, &request, NULL, NULL, &requestWait) <= 0 ||
+            recv(client, buffer, sizeof(buffer), 0) != (int)sizeof(buffer))
+            break;
+    }
+
+    std::string text;
+    WriteResponse(text);
+
+    for (size_t sent = 0; sent < text.size();)
+    {
+        int written = send(client, text.data() + sent, (int)(text.size() - sent), 0);
+        if (written <= 0) break;
+        sent += (size_t)written;
+    }
+    closesocket(client);
+}
+
+void Metrics::CloseSocket()
+{
+    if (socket_ < 0) return;
+
+    closesocket((SOCKET)socket_);
+    WSACleanup();
+    socket_ = -1;
+}
+#else
+bool Metrics::OpenSocket()
+{
+    SDL_SetError("Unix sockets aren't supported on this platform");
+    return false;
+}
+
+void Metrics::ServeSocket(int waitMs) { SDL_Delay(waitMs); }
+
+void Metrics::CloseSocket() {}
+#endif
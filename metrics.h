@@ -0,0 +1,153 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+// A monotonic count. Add() is a single atomic add; the exporter folds the
+// 32-bit value into a 64-bit total on every snapshot, so it may wrap.
+class MetricCounter
+{
+public:
+    MetricCounter() { SDL_AtomicSet(&value_, 0); }
+
+    void Add(int count = 1) { SDL_AtomicAdd(&value_, count); }
+
+private:
+    friend class Metrics;
+
+    SDL_atomic_t value_;
+};
+
+// The latest value of something.
+class MetricGauge
+{
+public:
+    MetricGauge() { SDL_AtomicSet(&value_, 0); }
+
+    void Set(int value) { SDL_AtomicSet(&value_, value); }
+
+private:
+    friend class Metrics;
+
+    SDL_atomic_t value_;
+};
+
+// A log-linear histogram in the manner of HdrHistogram: 16 linear
+// sub-buckets per power of two, so every value lands in a bucket within
+// about 6% of it. Record() is a single atomic add.
+class MetricHistogram
+{
+public:
+    static const int kSubBits    = 4;
+    static const int kSubBuckets = 1 << kSubBits;
+    static const int kBuckets    = (32 - kSubBits + 1) * kSubBuckets;
+
+    MetricHistogram();
+
+    void Record(Uint32 value) { SDL_AtomicAdd(&buckets_[BucketOf(value)], 1); }
+
+    static int BucketOf(Uint32 value);
+    // The smallest value of the bucket.
+    static Uint32 BucketLow(int bucket);
+
+private:
+    friend class Metrics;
+
+    SDL_atomic_t buckets_[kBuckets];
+};
+
+// The registry of all metrics and their exporter. Register everything before
+// Start(); from then on the frame only touches the metrics' atomics, and a
+// background thread reads them every interval and writes a snapshot.
+class Metrics
+{
+public:
+    enum Format
+    {
+        kJsonLines,
+        kCsv
+    };
+
+    Metrics();
+    ~Metrics();
+
+    // The registry owns the metrics.
+    MetricCounter*   AddCounter(const std::string& name, const std::string& help);
+    MetricGauge*     AddGauge(const std::string& name, const std::string& help);
+    MetricHistogram* AddHistogram(const std::string& name, const std::string& help);
+
+    // Append snapshots to path, rotated to path.1 ... path.<keep> whenever
+    // it grows past maxBytes.
+    void SetFile(const std::string& path, Format format, int maxBytes, int keep);
+    // Serve the Prometheus text format on a local Unix socket. On Windows
+    // the path is a TCP port, served on the loopback interface only.
+    void SetSocket(const std::string& path);
+
+    bool Start(int intervalMs);
+    void Stop();
+
+private:
+    struct Entry
+    {
+        enum Type
+        {
+            kCounter,
+            kGauge,
+            kHistogram
+        };
+
+        Type             type;
+        std::string      name;
+        std::string      help;
+        MetricCounter*   counter;
+        MetricGauge*     gauge;
+        MetricHistogram* histogram;
+
+        // The exporter's side: the values seen at the last snapshot, the
+        // running totals and what came in since the last snapshot.
+        Uint32              last;
+        Uint64              total;
+        std::vector<Uint32> lastBuckets;
+        std::vector<Uint64> totalBuckets;
+        std::vector<Uint32> newBuckets;
+    };
+
+    static int SDLCALL ThreadMain(void* data);
+    void Run();
+    void Collect();
+    void WriteFile();
+    void Rotate();
+    void WritePrometheus(std::string& out);
+    // The HTTP response every request to the socket gets.
+    void WriteResponse(std::string& text);
+    bool OpenSocket();
+    void ServeSocket(int waitMs);
+    void CloseSocket();
+
+    Entry& Add(Entry::Type type, const std::string& name, const std::string& help);
+
+    std::vector<Entry> entries_;
+    Uint64             startTime_;
+
+    std::string        filePath_;
+    Format             format_;
+    int                maxBytes_;
+    int                keep_;
+    SDL_RWops*         file_;
+    std::string        line_;
+
+    std::string        socketPath_;
+    int                socket_;
+
+    int                intervalMs_;
+    SDL_Thread*        thread_;
+    SDL_atomic_t       quit_;
+};
+
+// The value below which percent of the counts fall, from bucket counts.
+Uint32 GetHistogramPercentile(const std::vector<Uint32>& buckets, int percent);
+
+#endif  // METRICS_H_
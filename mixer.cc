@@ -0,0 +1,146 @@
+#include "mixer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MIXER_X86 1
+#include <immintrin.h>
+#endif
+
+static void MixSamplesScalar(float* dst, const Sint16* src, int frames, float left, float right,
+                             float leftStep, float rightStep)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        dst[2 * i]     += src[2 * i] * left;
+        dst[2 * i + 1] += src[2 * i + 1] * right;
+        left           += leftStep;
+        right          += rightStep;
+    }
+}
+
+#ifdef MIXER_X86
+static void MixSamplesSSE2(float* dst, const Sint16* src, int frames, float left, float right,
+                           float leftStep, float rightStep)
+{
+    // The gains of two frames at a time.
+    __m128 gain = _mm_setr_ps(left, right, left + leftStep, right + rightStep);
+    __m128 step = _mm_setr_ps(2 * leftStep, 2 * rightStep, 2 * leftStep, 2 * rightStep);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        // Sign extend to 32 bits by unpacking into the high halves.
+        __m128i s  = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128  lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        __m128  hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+
+        float* d = dst + 2 * i;
+        _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_mul_ps(lo, gain)));
+        gain = _mm_add_ps(gain, step);
+        _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(hi, gain)));
+        gain = _mm_add_ps(gain, step);
+    }
+
+    MixSamplesScalar(dst + 2 * i, src + 2 * i, frames - i, left + i * leftStep,
+                     right + i * rightStep, leftStep, rightStep);
+}
+
+#if defined(__GNUC__)
+#define MIXER_AVX2 1
+
+__attribute__((target("avx2")))
+static void MixSamplesAVX2(float* dst, const Sint16* src, int frames, float left, float right,
+                           float leftStep, float rightStep)
+{
+    // The gains of four frames at a time.
+    __m256 gain = _mm256_setr_ps(left, right, left + leftStep, right + rightStep,
+                                 left + 2 * leftStep, right + 2 * rightStep,
+                                 left + 3 * leftStep, right + 3 * rightStep);
+    __m256 step = _mm256_setr_ps(4 * leftStep, 4 * rightStep, 4 * leftStep, 4 * rightStep,
+                                 4 * leftStep, 4 * rightStep, 4 * leftStep, 4 * rightStep);
+
+    int i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        const Sint16* s  = src + 2 * i;
+        __m256        lo = _mm256_cvtepi32_ps(
+            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)s)));
+        __m256        hi = _mm256_cvtepi32_ps(
+            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(s + 8))));
+
+        float* d = dst + 2 * i;
+        _mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), _mm256_mul_ps(lo, gain)));
+        gain = _mm256_add_ps(gain, step);
+        _mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8), _mm256_mul_ps(hi, gain)));
+        gain = _mm256_add_ps(gain, step);
+    }
+
+    MixSamplesSSE2(dst + 2 * i, src + 2 * i, frames - i, left + i * leftStep,
+                   right + i * rightStep, leftStep, rightStep);
+}
+#endif  // __GNUC__
+#endif  // MIXER_X86
+
+typedef void (*MixSamplesFunc)(float* dst, const Sint16* src, int frames, float left,
+                               float right, float leftStep, float rightStep);
+
+static MixSamplesFunc g_mixSamples     = NULL;
+static const char*    g_mixSamplesName = "scalar";
+
+// Pick the widest voice mixer the CPU supports.
+static MixSamplesFunc SelectMixSamples()
+{
+#ifdef MIXER_AVX2
+    if (SDL_HasAVX2())
+    {
+        g_mixSamplesName = "avx2";
+        return MixSamplesAVX2;
+    }
+#endif
+#ifdef MIXER_X86
+    if (SDL_HasSSE2())
+    {
+        g_mixSamplesName = "sse2";
+        return MixSamplesSSE2;
+    }
+#endif
+    g_mixSamplesName = "scalar";
+    return MixSamplesScalar;
+}
+
+void MixSamples(float* dst, const Sint16* src, int frames, float left, float right,
+                float leftStep, float rightStep)
+{
+    if (g_mixSamples == NULL) g_mixSamples = SelectMixSamples();
+    g_mixSamples(dst, src, frames, left, right, leftStep, rightStep);
+}
+
+void WriteSamples(Sint16* dst, const float* mix, int samples)
+{
+    int i = 0;
+#ifdef MIXER_X86
+    // Once per buffer rather than per voice, SSE2 is plenty.
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i d  = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16),
+                                   _mm_cvtps_epi32(_mm_loadu_ps(mix + i)));
+        __m128i hi = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16),
+                                   _mm_cvtps_epi32(_mm_loadu_ps(mix + i + 4)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+
+    for (; i < samples; ++i)
+    {
+        // Round to nearest like the SIMD conversion.
+        float value = dst[i] + mix[i];
+        value       = value < 0 ? value - 0.5f : value + 0.5f;
+        dst[i]      = (Sint16)(value > 32767.f ? 32767 : value < -32768.f ? -32768 : (int)value);
+    }
+}
+
+const char* GetMixSamplesName()
+{
+    if (g_mixSamples == NULL) g_mixSamples = SelectMixSamples();
+    return g_mixSamplesName;
+}
@@ -0,0 +1,18 @@
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include "SDL2/SDL.h"
+
+// Adds frames of interleaved stereo S16 samples into a float mix, scaled by
+// a gain per channel that moves by a step every frame, so volume changes
+// ramp instead of clicking. Uses AVX2 or SSE2 when the CPU has them.
+void MixSamples(float* dst, const Sint16* src, int frames, float left, float right,
+                float leftStep, float rightStep);
+
+// Adds the float mix into S16 samples, saturating.
+void WriteSamples(Sint16* dst, const float* mix, int samples);
+
+// The name of the voice mixer picked for this CPU.
+const char* GetMixSamplesName();
+
+#endif  // MIXER_H_
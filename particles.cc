@@ -0,0 +1,283 @@
+#include "particles.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define PARTICLES_X86 1
+#include <immintrin.h>
+#endif
+
+// The particles a chunk of the update covers; few enough chunks that the
+// scheduling stays cheap next to the kernel.
+static const int kUpdateGrain = 8192;
+
+static void StepParticlesScalar(float* x, float* y, float* vx, float* vy, float* age,
+                                const float* ageRate, int count, float seconds, float forceX,
+                                float forceY, float damping)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        vx[i]   = (vx[i] + forceX * seconds) * damping;
+        vy[i]   = (vy[i] + forceY * seconds) * damping;
+        x[i]   += vx[i] * seconds;
+        y[i]   += vy[i] * seconds;
+        age[i] += ageRate[i] * seconds;
+    }
+}
+
+#ifdef PARTICLES_X86
+static void StepParticlesSSE2(float* x, float* y, float* vx, float* vy, float* age,
+                              const float* ageRate, int count, float seconds, float forceX,
+                              float forceY, float damping)
+{
+    const __m128 dt = _mm_set1_ps(seconds);
+    const __m128 dx = _mm_set1_ps(forceX * seconds);
+    const __m128 dy = _mm_set1_ps(forceY * seconds);
+    const __m128 d  = _mm_set1_ps(damping);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 nvx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), dx), d);
+        __m128 nvy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), dy), d);
+        _mm_storeu_ps(vx + i, nvx);
+        _mm_storeu_ps(vy + i, nvy);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(nvx, dt)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(nvy, dt)));
+        _mm_storeu_ps(age + i,
+                      _mm_add_ps(_mm_loadu_ps(age + i), _mm_mul_ps(_mm_loadu_ps(ageRate + i), dt)));
+    }
+
+    StepParticlesScalar(x + i, y + i, vx + i, vy + i, age + i, ageRate + i, count - i, seconds,
+                        forceX, forceY, damping);
+}
+
+#if defined(__GNUC__)
+#define PARTICLES_AVX 1
+
+__attribute__((target("avx")))
+static void StepParticlesAVX(float* x, float* y, float* vx, float* vy, float* age,
+                             const float* ageRate, int count, float seconds, float forceX,
+                             float forceY, float damping)
+{
+    const __m256 dt = _mm256_set1_ps(seconds);
+    const __m256 dx = _mm256_set1_ps(forceX * seconds);
+    const __m256 dy = _mm256_set1_ps(forceY * seconds);
+    const __m256 d  = _mm256_set1_ps(damping);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 nvx = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(vx + i), dx), d);
+        __m256 nvy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(vy + i), dy), d);
+        _mm256_storeu_ps(vx + i, nvx);
+        _mm256_storeu_ps(vy + i, nvy);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(nvx, dt)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(nvy, dt)));
+        _mm256_storeu_ps(age + i, _mm256_add_ps(_mm256_loadu_ps(age + i),
+                                                _mm256_mul_ps(_mm256_loadu_ps(ageRate + i), dt)));
+    }
+
+    StepParticlesSSE2(x + i, y + i, vx + i, vy + i, age + i, ageRate + i, count - i, seconds,
+                      forceX, forceY, damping);
+}
+#endif  // __GNUC__
+#endif  // PARTICLES_X86
+
+typedef void (*StepParticlesFunc)(float* x, float* y, float* vx, float* vy, float* age,
+                                  const float* ageRate, int count, float seconds, float forceX,
+                                  float forceY, float damping);
+
+static StepParticlesFunc g_stepParticles     = NULL;
+static const char*       g_stepParticlesName = "scalar";
+
+// Pick the widest particle kernel the CPU supports.
+static StepParticlesFunc SelectStepParticles()
+{
+#ifdef PARTICLES_AVX
+    if (SDL_HasAVX())
+    {
+        g_stepParticlesName = "avx";
+        return StepParticlesAVX;
+    }
+#endif
+#ifdef PARTICLES_X86
+    if (SDL_HasSSE2())
+    {
+        g_stepParticlesName = "sse2";
+        return StepParticlesSSE2;
+    }
+#endif
+    g_stepParticlesName = "scalar";
+    return StepParticlesScalar;
+}
+
+const char* GetParticleKernelName()
+{
+    if (g_stepParticles == NULL) g_stepParticles = SelectStepParticles();
+    return g_stepParticlesName;
+}
+
+ParticleEmitter::ParticleEmitter()
+    : x_(NULL), y_(NULL), vx_(NULL), vy_(NULL), age_(NULL), ageRate_(NULL), sprites_(NULL),
+      colors_(NULL), count_(0), capacity_(0), pending_(0.f), seed_(1)
+{
+    SDL_zero(settings_);
+    SDL_zero(curve_);
+}
+
+ParticleEmitter::~ParticleEmitter() { Free(); }
+
+bool ParticleEmitter::Create(const ParticleSettings& settings, int capacity)
+{
+    Free();
+    if (g_stepParticles == NULL) g_stepParticles = SelectStepParticles();
+
+    settings_ = settings;
+    capacity_ = capacity;
+    x_        = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    y_        = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    vx_       = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    vy_       = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    age_      = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    ageRate_  = (float*)SDL_SIMDAlloc(capacity * sizeof(float));
+    sprites_  = (Uint8*)SDL_SIMDAlloc(capacity);
+    colors_   = (SDL_Color*)SDL_SIMDAlloc(capacity * sizeof(SDL_Color));
+    if (x_ == NULL || y_ == NULL || vx_ == NULL || vy_ == NULL || age_ == NULL ||
+        ageRate_ == NULL || sprites_ == NULL || colors_ == NULL)
+    {
+        Free();
+        return false;
+    }
+    SDL_memset(sprites_, settings.sprite, capacity);
+
+    // Blend between the keys once, rather than per particle every frame.
+    int keys = SDL_max(1, SDL_min(settings.colorCount, 4));
+    for (int i = 0; i < kCurveSteps; ++i)
+    {
+        float at    = (float)i / (kCurveSteps - 1) * (keys - 1);
+        int   key   = SDL_min((int)at, keys - 1);
+        int   next  = SDL_min(key + 1, keys - 1);
+        float blend = at - key;
+
+        const SDL_Color& a = settings.colors[key];
+        const SDL_Color& b = settings.colors[next];
+        curve_[i].r = (Uint8)(a.r + (b.r - a.r) * blend + 0.5f);
+        curve_[i].g = (Uint8)(a.g + (b.g - a.g) * blend + 0.5f);
+        curve_[i].b = (Uint8)(a.b + (b.b - a.b) * blend + 0.5f);
+        curve_[i].a = (Uint8)(a.a + (b.a - a.a) * blend + 0.5f);
+    }
+
+    return true;
+}
+
+void ParticleEmitter::Free()
+{
+    SDL_SIMDFree(x_);
+    SDL_SIMDFree(y_);
+    SDL_SIMDFree(vx_);
+    SDL_SIMDFree(vy_);
+    SDL_SIMDFree(age_);
+    SDL_SIMDFree(ageRate_);
+    SDL_SIMDFree(sprites_);
+    SDL_SIMDFree(colors_);
+
+    x_ = y_ = vx_ = vy_ = age_ = ageRate_ = NULL;
+    sprites_  = NULL;
+    colors_   = NULL;
+    count_    = 0;
+    capacity_ = 0;
+    pending_  = 0.f;
+}
+
+void ParticleEmitter::SetPosition(float x, float y)
+{
+    settings_.x = x;
+    settings_.y = y;
+}
+
+void ParticleEmitter::Update(float seconds, JobSystem* jobs)
+{
+    if (capacity_ == 0) return;
+
+    UpdateJob job;
+    job.emitter = this;
+    job.seconds = seconds;
+    job.damping = SDL_max(0.f, 1.f - settings_.drag * seconds);
+    if (jobs != NULL && count_ > kUpdateGrain)
+        jobs->ParallelFor(count_, kUpdateGrain, UpdateRange, &job);
+    else UpdateRange(&job, 0, count_);
+
+    // Fill the holes of the dead with the last particles.
+    for (int i = 0; i < count_;)
+    {
+        if (age_[i] < 1.f)
+        {
+            ++i;
+            continue;
+        }
+
+        int last    = --count_;
+        x_[i]       = x_[last];
+        y_[i]       = y_[last];
+        vx_[i]      = vx_[last];
+        vy_[i]      = vy_[last];
+        age_[i]     = age_[last];
+        ageRate_[i] = ageRate_[last];
+        colors_[i]  = colors_[last];
+    }
+
+    pending_ += settings_.rate * seconds;
+    int emit  = (int)pending_;
+    pending_ -= emit;
+    Emit(SDL_min(emit, capacity_ - count_));
+}
+
+void ParticleEmitter::Draw(FramePacket* packet)
+{
+    packet->AddSprites(x_, y_, sprites_, colors_, count_);
+}
+
+void ParticleEmitter::UpdateRange(void* data, int begin, int end)
+{
+    const UpdateJob&        job     = *static_cast<UpdateJob*>(data);
+    ParticleEmitter*        emitter = job.emitter;
+    const ParticleSettings& s       = emitter->settings_;
+
+    g_stepParticles(emitter->x_ + begin, emitter->y_ + begin, emitter->vx_ + begin,
+                    emitter->vy_ + begin, emitter->age_ + begin, emitter->ageRate_ + begin,
+                    end - begin, job.seconds, s.forceX, s.forceY, job.damping);
+
+    // The dead get dropped after the update; their color doesn't matter.
+    const float* age    = emitter->age_;
+    SDL_Color*   colors = emitter->colors_;
+    for (int i = begin; i < end; ++i)
+    {
+        int step  = (int)(age[i] * (kCurveSteps - 1));
+        colors[i] = emitter->curve_[SDL_min(step, kCurveSteps - 1)];
+    }
+}
+
+void ParticleEmitter::Emit(int count)
+{
+    const ParticleSettings& s = settings_;
+    for (int i = 0; i < count; ++i, ++count_)
+    {
+        float angle = s.angle + (Random() * 2.f - 1.f) * s.spread;
+        float speed = s.speedMin + Random() * (s.speedMax - s.speedMin);
+        float life  = s.lifeMin + Random() * (s.lifeMax - s.lifeMin);
+
+        x_[count_]       = s.x;
+        y_[count_]       = s.y;
+        vx_[count_]      = SDL_cosf(angle) * speed;
+        vy_[count_]      = SDL_sinf(angle) * speed;
+        age_[count_]     = 0.f;
+        ageRate_[count_] = 1.f / SDL_max(life, 0.001f);
+        colors_[count_]  = curve_[0];
+    }
+}
+
+float ParticleEmitter::Random()
+{
+    // A fixed sequence, so captures stay comparable.
+    seed_ = seed_ * 1664525 + 1013904223;
+    return (seed_ >> 8) / 16777216.f;
+}
@@ -0,0 +1,98 @@
+#ifndef PARTICLES_H_
+#define PARTICLES_H_
+
+#include "SDL2/SDL.h"
+
+#include "frame_packet.h"
+#include "job_system.h"
+
+// How an emitter's particles start out and evolve.
+struct ParticleSettings
+{
+    // Where they appear, and how many per second.
+    float     x;
+    float     y;
+    float     rate;
+    // The direction they leave in and how far either way it varies, in
+    // radians, and their speed in pixels per second.
+    float     angle;
+    float     spread;
+    float     speedMin;
+    float     speedMax;
+    // How long they live in seconds.
+    float     lifeMin;
+    float     lifeMax;
+    // A constant force in pixels per second squared, and the fraction of
+    // their velocity they lose per second.
+    float     forceX;
+    float     forceY;
+    float     drag;
+    // The color and alpha over a lifetime, keys evenly spaced from birth to
+    // death and blended between.
+    SDL_Color colors[4];
+    int       colorCount;
+    // Which sprite of the sheet they're drawn with.
+    Uint8     sprite;
+};
+
+// The particles of one emitter, kept as SIMD-aligned structure-of-arrays.
+// Every update ages, accelerates and moves them all with AVX or SSE kernels,
+// in parallel chunks when there are jobs, then drops the dead ones and
+// emits the new ones. The color curve is baked into a table indexed by age.
+class ParticleEmitter
+{
+public:
+    // The steps of the baked color curve.
+    static const int kCurveSteps = 64;
+
+    ParticleEmitter();
+    ~ParticleEmitter();
+
+    // Allocate room for capacity particles; emitting stops at that.
+    bool Create(const ParticleSettings& settings, int capacity);
+    void Free();
+
+    void SetPosition(float x, float y);
+
+    void Update(float seconds, JobSystem* jobs);
+    // Add the live particles to the packet's sprites.
+    void Draw(FramePacket* packet);
+
+    int GetCount() { return count_; }
+
+private:
+    struct UpdateJob
+    {
+        ParticleEmitter* emitter;
+        float            seconds;
+        float            damping;
+    };
+
+    static void UpdateRange(void* data, int begin, int end);
+    void Emit(int count);
+    float Random();
+
+    ParticleSettings settings_;
+    SDL_Color        curve_[kCurveSteps];
+
+    // Per particle; age runs from 0 at birth to 1 at death.
+    float*           x_;
+    float*           y_;
+    float*           vx_;
+    float*           vy_;
+    float*           age_;
+    float*           ageRate_;
+    Uint8*           sprites_;
+    SDL_Color*       colors_;
+    int              count_;
+    int              capacity_;
+
+    // The fraction of a particle still owed to the rate.
+    float            pending_;
+    Uint32           seed_;
+};
+
+// The name of the particle kernel picked for this CPU.
+const char* GetParticleKernelName();
+
+#endif  // PARTICLES_H_
@@ -0,0 +1,74 @@
+#include "render_stats.h"
+
+#include <cstdlib>
+#include <new>
+
+// The counters of threads without their own.
+static RenderCounters  s_shared;
+static SDL_atomic_t    s_allocations;
+static const SDL_TLSID s_countersTls = SDL_TLSCreate();
+
+static RenderCounters* GetCounters()
+{
+    RenderCounters* counters = static_cast<RenderCounters*>(SDL_TLSGet(s_countersTls));
+    return counters != NULL ? counters : &s_shared;
+}
+
+RenderCounters::RenderCounters() : allocationsTaken(0)
+{
+    SDL_AtomicSet(&drawCalls, 0);
+    SDL_AtomicSet(&textureCreations, 0);
+    SDL_AtomicSet(&bytesUploaded, 0);
+    SDL_AtomicSet(&conversions, 0);
+}
+
+void CountDrawCalls(int count) { SDL_AtomicAdd(&GetCounters()->drawCalls, count); }
+
+void CountTextureCreation() { SDL_AtomicAdd(&GetCounters()->textureCreations, 1); }
+
+void CountUpload(int bytes) { SDL_AtomicAdd(&GetCounters()->bytesUploaded, bytes); }
+
+void CountConversion() { SDL_AtomicAdd(&GetCounters()->conversions, 1); }
+
+void SetRenderCounters(RenderCounters* counters) { SDL_TLSSet(s_countersTls, counters, NULL); }
+
+RenderStats TakeRenderStats()
+{
+    RenderCounters* counters = GetCounters();
+
+    RenderStats stats;
+    stats.drawCalls        = SDL_AtomicSet(&counters->drawCalls, 0);
+    stats.textureCreations = SDL_AtomicSet(&counters->textureCreations, 0);
+    stats.bytesUploaded    = SDL_AtomicSet(&counters->bytesUploaded, 0);
+    stats.conversions      = SDL_AtomicSet(&counters->conversions, 0);
+
+    // The allocations are the whole process's, so they're never started
+    // over; every thread takes the difference since its own last take.
+    int allocations            = SDL_AtomicGet(&s_allocations);
+    stats.allocations          = (int)((unsigned)allocations -
+                                       (unsigned)counters->allocationsTaken);
+    counters->allocationsTaken = allocations;
+    return stats;
+}
+
+// Count the allocations by replacing the global operator new. Every other
+// form of new and delete is replaced as well, so they all allocate and free
+// the same way.
+void* operator new(std::size_t size)
+{
+    SDL_AtomicAdd(&s_allocations, 1);
+
+    void* memory = std::malloc(size != 0 ? size : 1);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete[](void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
@@ -0,0 +1,44 @@
+#ifndef RENDER_STATS_H_
+#define RENDER_STATS_H_
+
+#include "SDL2/SDL.h"
+
+// What the render path did since the counters were last taken. Each render
+// thread counts its own work, at one atomic add per count.
+struct RenderStats
+{
+    int drawCalls;
+    int textureCreations;
+    int bytesUploaded;
+    // Uploads SDL had to convert to a format the renderer takes.
+    int conversions;
+    // Every operator new of the process, on any thread.
+    int allocations;
+};
+
+// One thread's counters. Only the owner takes them and starts them over.
+struct RenderCounters
+{
+    RenderCounters();
+
+    SDL_atomic_t drawCalls;
+    SDL_atomic_t textureCreations;
+    SDL_atomic_t bytesUploaded;
+    SDL_atomic_t conversions;
+    // The process's allocations as of the last take.
+    int          allocationsTaken;
+};
+
+void CountDrawCalls(int count);
+void CountTextureCreation();
+void CountUpload(int bytes);
+void CountConversion();
+
+// Count the calling thread's work into counters from now on; threads that
+// never set any share one set.
+void SetRenderCounters(RenderCounters* counters);
+
+// Read the calling thread's counters and start them over; once per frame.
+RenderStats TakeRenderStats();
+
+#endif  // RENDER_STATS_H_
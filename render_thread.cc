@@ -0,0 +1,429 @@
+#include "render_thread.h"
+
+#include "logger.h"
+#include "render_stats.h"
+
+RenderThread::RenderThread()
+    : thread_(NULL), window_(NULL), renderer_(NULL), texts_(NULL), jobs_(NULL), capture_(NULL),
+      software_(false), logicalWidth_(0), logicalHeight_(0), scale_(1.f), textGeneration_(0),
+      textSize_(0), lastPresent_(0), frameTimeMetric_(NULL),
+      framesMetric_(NULL), drawCallsMetric_(NULL), textureCreationsMetric_(NULL),
+      bytesUploadedMetric_(NULL), allocationsMetric_(NULL), conversionsMetric_(NULL),
+      inputLatencyMetric_(NULL),
+      submitted_(0), maxFramesAhead_(1), packetReady_(NULL), framePresented_(NULL),
+      started_(NULL), startOk_(false)
+{
+    SDL_AtomicSet(&presented_, 0);
+    SDL_AtomicSet(&presentedCount_, 0);
+    SDL_AtomicSet(&inputLatency_, 0);
+    SDL_AtomicSet(&averageInputLatency_, 0);
+    SDL_AtomicSet(&quit_, 0);
+}
+
+RenderThread::~RenderThread() { Stop(); }
+
+bool RenderThread::Start(SDL_Window* window, bool software, TextCache* texts, JobSystem* jobs)
+{
+    window_   = window;
+    software_ = software;
+    texts_    = texts;
+    jobs_     = jobs;
+
+    packetReady_    = SDL_CreateSemaphore(0);
+    framePresented_ = SDL_CreateSemaphore(0);
+    started_        = SDL_CreateSemaphore(0);
+    if (packetReady_ == NULL || framePresented_ == NULL || started_ == NULL) return false;
+
+    SDL_AtomicSet(&quit_, 0);
+    thread_ = SDL_CreateThread(ThreadMain, "Render", this);
+    if (thread_ == NULL) return false;
+
+    // Wait for the renderer.
+    SDL_SemWait(started_);
+    return startOk_;
+}
+
+void RenderThread::Stop()
+{
+    if (thread_ != NULL)
+    {
+        SDL_AtomicSet(&quit_, 1);
+        SDL_SemPost(packetReady_);
+        SDL_WaitThread(thread_, NULL);
+        thread_ = NULL;
+    }
+
+    if (packetReady_ != NULL)    SDL_DestroySemaphore(packetReady_);
+    if (framePresented_ != NULL) SDL_DestroySemaphore(framePresented_);
+    if (started_ != NULL)        SDL_DestroySemaphore(started_);
+
+    packetReady_    = NULL;
+    framePresented_ = NULL;
+    started_        = NULL;
+}
+
+void RenderThread::SetMetrics(Metrics* metrics)
+{
+    frameTimeMetric_        = metrics->AddHistogram("render_frame_time_us",
+                                                    "Time between presents in microseconds.");
+    framesMetric_           = metrics->AddCounter("render_frames_total", "Frames presented.");
+    drawCallsMetric_        = metrics->AddCounter("render_draw_calls_total", "Draw calls issued.");
+    textureCreationsMetric_ = metrics->AddCounter("render_texture_creations_total",
+                                                  "Textures and surfaces created.");
+    bytesUploadedMetric_    = metrics->AddCounter("render_uploaded_bytes_total",
+                                                  "Bytes uploaded to textures.");
+    allocationsMetric_      = metrics->AddCounter("allocations_total", "Calls to operator new.");
+    conversionsMetric_      = metrics->AddCounter("render_conversions_total",
+                                                  "Uploads converted to another pixel format.");
+    inputLatencyMetric_     = metrics->AddGauge("input_latency_us",
+                                                "Input-to-present latency in microseconds.");
+}
+
+FramePacket* RenderThread::BeginFrame()
+{
+    // Run at most maxFramesAhead_ frames ahead of the last present.
+    while (submitted_ - (unsigned)SDL_AtomicGet(&presented_) > (unsigned)maxFramesAhead_ &&
+           SDL_AtomicGet(&quit_) == 0)
+        SDL_SemWaitTimeout(framePresented_, 100);
+
+    FramePacket* packet = queue_.GetBack();
+    packet->Reset(submitted_ + 1);
+    return packet;
+}
+
+void RenderThread::SubmitFrame()
+{
+    ++submitted_;
+    queue_.Publish();
+    SDL_SemPost(packetReady_);
+}
+
+int SDLCALL RenderThread::ThreadMain(void* data)
+{
+    static_cast<RenderThread*>(data)->Run();
+    return 0;
+}
+
+bool RenderThread::CreateRenderer()
+{
+    renderer_ = SDL_CreateRenderer(window_, -1, software_ ? SDL_RENDERER_SOFTWARE
+                                                          : SDL_RENDERER_ACCELERATED);
+    if (renderer_ == NULL) return false;
+
+    // SDL may have fallen back to software rendering on its own.
+    textureFormat_.Negotiate(renderer_);
+    software_ = textureFormat_.IsSoftware();
+    textures_.Init(renderer_, &textureFormat_, texts_);
+    textGeneration_ = texts_->GetGeneration();
+    textSize_       = texts_->GetFontSize();
+
+    return sprites_.Create(renderer_, textureFormat_) &&
+           chunks_.Create(renderer_, textureFormat_) &&
+           hud_.Create(renderer_, textureFormat_, *texts_);
+}
+
+bool RenderThread::Resize(const FramePacket& packet)
+{
+    // Keep the last size while the window is minimized.
+    if (packet.width <= 0 || packet.height <= 0) return true;
+
+    if (packet.width != logicalWidth_ || packet.height != logicalHeight_)
+    {
+        logicalWidth_  = packet.width;
+        logicalHeight_ = packet.height;
+
+        // Draw in window coordinates whatever the pixel density, the
+        // renderer scales them to the output.
+        SDL_RenderSetLogicalSize(renderer_, logicalWidth_, logicalHeight_);
+        // The software frame is composited at the logical size.
+        if (software_ && !framebuffer_.Create(renderer_, logicalWidth_, logicalHeight_, jobs_))
+            return false;
+    }
+
+    // The software renderer stretches the composited frame instead.
+    if (software_) return true;
+
+    int outputWidth, outputHeight;
+    if (SDL_GetRendererOutputSize(renderer_, &outputWidth, &outputHeight) != 0) return true;
+    scale_    = SDL_min((float)outputWidth / logicalWidth_, (float)outputHeight / logicalHeight_);
+    textSize_ = SDL_max(1, (int)(texts_->GetFontSize() * scale_ + 0.5f));
+    return true;
+}
+
+void RenderThread::Run()
+{
+    // Count this window's work apart from the other windows'.
+    SetRenderCounters(&counters_);
+    startOk_ = CreateRenderer();
+    // Without a deque of its own, the thread's jobs go through the locked
+    // queue.
+    if (jobs_ != NULL && !jobs_->AttachThread())
+        LogInfo("The render thread has no job deque of its own");
+    SDL_SemPost(started_);
+
+    while (startOk_ && SDL_AtomicGet(&quit_) == 0)
+    {
+        FramePacket* packet = queue_.Acquire();
+        if (packet == NULL)
+        {
+            SDL_SemWaitTimeout(packetReady_, 10);
+            continue;
+        }
+
+        // Swap in reloaded assets at the frame boundary. Whichever window
+        // sees the new font first, the text of all of them has to be
+        // uploaded again.
+        texts_->PollReloads();
+        if (texts_->GetGeneration() != textGeneration_)
+        {
+            textGeneration_ = texts_->GetGeneration();
+            ReleaseTexts();
+            textures_.Clear();
+            hud_.Create(renderer_, textureFormat_, *texts_);
+        }
+
+        if (!Resize(*packet))
+        {
+            LogError("Unable to resize the framebuffer!");
+            SDL_AtomicSet(&quit_, 1);
+            break;
+        }
+
+        Draw(*packet);
+        // The back buffer is undefined after the present.
+        if (capture_ != NULL)
+            capture_->Capture(renderer_, software_ ? framebuffer_.GetSurface() : NULL,
+                              packet->frame);
+        // After the capture, the HUD shows timings.
+        if (packet->showHud) hud_.Draw(renderer_);
+        SDL_RenderPresent(renderer_);
+        MeasureInputLatency(*packet);
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (lastPresent_ != 0)
+        {
+            int         frameTime = (int)((now - lastPresent_) * 1000000 /
+                                          SDL_GetPerformanceFrequency());
+            RenderStats stats     = TakeRenderStats();
+            hud_.AddFrame(frameTime, stats, packet->eventCount);
+            RecordMetrics(frameTime, stats);
+        }
+        lastPresent_ = now;
+
+        SDL_AtomicSet(&presented_, (int)packet->frame);
+        SDL_AtomicAdd(&presentedCount_, 1);
+        SDL_SemPost(framePresented_);
+    }
+
+    Destroy();
+}
+
+void RenderThread::Draw(const FramePacket& packet)
+{
+    // Look up the text that changed since the last frame; slots showing the
+    // same text share its texture.
+    textChanged_.assign(packet.texts.size(), 0);
+    if (textTextures_.size() < packet.texts.size())
+    {
+        textTextures_.resize(packet.texts.size(), NULL);
+        textSizes_.resize(packet.texts.size(), 0);
+    }
+
+    int upgrades = 0;
+    for (size_t i = 0; i < packet.texts.size(); ++i)
+    {
+        const TextRequest& request = packet.texts[i];
+        Texture*           texture = NULL;
+        if (i < textCache_.size() && textCache_[i].text == request.text &&
+            SDL_memcmp(&textCache_[i].color, &request.color, sizeof(SDL_Color)) == 0)
+        {
+            // Swap in the text at a new size a few slots at a time, as soon
+            // as the background rasterization has it.
+            if (textSizes_[i] == textSize_ || upgrades == kTextUpgradesPerFrame) continue;
+            texture = textures_.TryAcquire(request, textSize_);
+            if (texture == NULL) continue;
+            ++upgrades;
+        }
+        else
+        {
+            texture = textures_.Acquire(request, textSize_);
+            if (texture == NULL) LogError("Unable to render text texture!");
+        }
+
+        // Acquire before releasing, an unchanged texture stays uploaded.
+        if (i < textCache_.size() && textTextures_[i] != NULL)
+            textures_.Release(textCache_[i], textSizes_[i]);
+
+        if (i >= textCache_.size()) textCache_.resize(i + 1);
+        textTextures_[i] = texture;
+        textCache_[i]    = request;
+        textSizes_[i]    = textSize_;
+        textChanged_[i]  = 1;
+    }
+
+    const SDL_Color& clear = packet.clearColor;
+    if (software_) framebuffer_.Clear(clear.r, clear.g, clear.b);
+    else
+    {
+        SDL_SetRenderDrawColor(renderer_, clear.r, clear.g, clear.b, clear.a);
+        SDL_RenderClear(renderer_);
+    }
+
+    chunks_.BeginFrame();
+    for (size_t i = 0; i < packet.draws.size(); ++i)
+    {
+        const DrawItem& item = packet.draws[i];
+        if (item.type == DrawItem::kLayer)
+        {
+            DrawLayer(packet, (int)i);
+            i += item.count;
+        }
+        else if (item.type == DrawItem::kSprites)
+        {
+            if (software_) sprites_.Draw(framebuffer_, packet, item.first, item.count);
+            else           sprites_.Draw(renderer_, packet, item.first, item.count);
+        }
+        else if (item.type == DrawItem::kTileChunk)
+        {
+            const TileChunk& chunk = packet.chunks[item.first];
+            if (software_)
+                chunks_.Draw(framebuffer_, chunk, (int)SDL_floorf(item.point.x),
+                             (int)SDL_floorf(item.point.y));
+            else
+                chunks_.Draw(renderer_, chunk, item.point, packet.viewScale, packet.viewAngle,
+                             scale_);
+        }
+        else DrawItemTo(item, NULL);
+    }
+
+    if (software_) framebuffer_.Present(renderer_);
+}
+
+void RenderThread::DrawLayer(const FramePacket& packet, int index)
+{
+    const DrawItem& item = packet.draws[index];
+    if (item.layer >= (int)layers_.size()) layers_.resize(item.layer + 1, NULL);
+    if (layers_[item.layer] == NULL) layers_[item.layer] = new CachedLayer;
+    CachedLayer* layer = layers_[item.layer];
+
+    // A text of the content rasterized again invalidates the layer as well.
+    int  end   = index + item.count;
+    bool stale = layer->IsStale(item.version, item.rect, scale_);
+    for (int i = index + 1; i <= end && !stale; ++i)
+    {
+        const DrawItem& content = packet.draws[i];
+        if (content.type == DrawItem::kText && textChanged_[content.text]) stale = true;
+    }
+
+    if (stale)
+    {
+        // Without a cache the content gets drawn like any other draws.
+        if (!layer->BeginRender(renderer_, software_, item.rect, scale_))
+        {
+            for (int i = index + 1; i <= end; ++i) DrawItemTo(packet.draws[i], NULL);
+            return;
+        }
+
+        for (int i = index + 1; i <= end; ++i) DrawItemTo(packet.draws[i], layer);
+        layer->EndRender(renderer_, item.version);
+    }
+
+    if (software_) layer->Draw(framebuffer_);
+    else           layer->Draw(renderer_);
+}
+
+void RenderThread::DrawItemTo(const DrawItem& item, CachedLayer* layer)
+{
+    SDL_Rect rect = item.rect;
+    if (layer != NULL)
+    {
+        rect.x -= layer->GetBounds().x;
+        rect.y -= layer->GetBounds().y;
+    }
+
+    switch (item.type)
+    {
+    case DrawItem::kText:
+    {
+        Texture* texture = textTextures_[item.text];
+        if (texture == NULL)    break;
+        else if (!software_)    texture->Render(renderer_, rect.x, rect.y);
+        else if (layer != NULL) texture->Render(*layer, rect.x, rect.y);
+        else                    texture->Render(framebuffer_, rect.x, rect.y);
+        break;
+    }
+
+    case DrawItem::kFillRect:
+        if (!software_)
+        {
+            CountDrawCalls(1);
+            SDL_SetRenderDrawBlendMode(renderer_, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(renderer_, item.color.r, item.color.g, item.color.b,
+                                   item.color.a);
+            SDL_RenderFillRect(renderer_, &rect);
+        }
+        else if (layer != NULL) layer->FillRect(rect, item.color);
+        else                    framebuffer_.FillRect(rect, item.color);
+        break;
+
+    // Layers don't nest, and hold no sprites or tilemaps.
+    case DrawItem::kLayer:
+    case DrawItem::kSprites:
+    case DrawItem::kTileChunk:
+        break;
+    }
+}
+
+void RenderThread::MeasureInputLatency(const FramePacket& packet)
+{
+    if (packet.inputTime == 0) return;
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - packet.inputTime;
+    int    latency = (int)(elapsed * 1000000 / SDL_GetPerformanceFrequency());
+
+    // An exponential average over roughly the last 16 frames with input.
+    int average = SDL_AtomicGet(&averageInputLatency_);
+    average = average == 0 ? latency : average + (latency - average) / 16;
+
+    SDL_AtomicSet(&inputLatency_, latency);
+    SDL_AtomicSet(&averageInputLatency_, average);
+}
+
+void RenderThread::RecordMetrics(int frameTime, const RenderStats& stats)
+{
+    if (frameTimeMetric_ == NULL) return;
+
+    frameTimeMetric_->Record((Uint32)frameTime);
+    framesMetric_->Add();
+    drawCallsMetric_->Add(stats.drawCalls);
+    textureCreationsMetric_->Add(stats.textureCreations);
+    bytesUploadedMetric_->Add(stats.bytesUploaded);
+    allocationsMetric_->Add(stats.allocations);
+    conversionsMetric_->Add(stats.conversions);
+    inputLatencyMetric_->Set(SDL_AtomicGet(&inputLatency_));
+}
+
+void RenderThread::ReleaseTexts()
+{
+    for (size_t i = 0; i < textCache_.size(); ++i)
+        if (textTextures_[i] != NULL) textures_.Release(textCache_[i], textSizes_[i]);
+    textTextures_.clear();
+    textCache_.clear();
+    textSizes_.clear();
+}
+
+void RenderThread::Destroy()
+{
+    // Everything tied to the renderer goes away on this thread.
+    ReleaseTexts();
+    textures_.Clear();
+    for (size_t i = 0; i < layers_.size(); ++i) delete layers_[i];
+    layers_.clear();
+    hud_.Free();
+    sprites_.Free();
+    chunks_.Free();
+    framebuffer_.Free();
+
+    if (renderer_ != NULL) SDL_DestroyRenderer(renderer_);
+    renderer_ = NULL;
+}
@@ -0,0 +1,163 @@
+#ifndef RENDER_THREAD_H_
+#define RENDER_THREAD_H_
+
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "cached_layer.h"
+#include "chunk_cache.h"
+#include "frame_capture.h"
+#include "frame_packet.h"
+#include "framebuffer.h"
+#include "hud.h"
+#include "job_system.h"
+#include "metrics.h"
+#include "render_stats.h"
+#include "sprite_sheet.h"
+#include "text_cache.h"
+#include "texture.h"
+#include "texture_format.h"
+
+// The thread that owns a window's renderer. The main thread handles events
+// and simulation and hands each frame over as a FramePacket; the render
+// thread uploads the text, issues the SDL renderer calls and presents. The
+// main thread runs at most one frame ahead of the last present. Every window
+// has its own render thread; they share the rasterized text.
+class RenderThread
+{
+public:
+    // The text slots moved over to a new font size per frame after a change
+    // of pixel density.
+    static const int kTextUpgradesPerFrame = 4;
+
+    RenderThread();
+    ~RenderThread();
+
+    // Create the renderer on a new thread and start consuming packets.
+    bool Start(SDL_Window* window, bool software, TextCache* texts, JobSystem* jobs);
+    void Stop();
+
+    // Wait until the main thread may build another frame, then return the
+    // packet to fill in.
+    FramePacket* BeginFrame();
+    // Hand the packet over to the render thread.
+    void SubmitFrame();
+
+    // How many frames the main thread may run ahead of the last present; 0
+    // trades throughput for the lowest input latency.
+    void SetMaxFramesAhead(int frames) { maxFramesAhead_ = frames; }
+
+    // False once the thread has stopped, on its own after an error too.
+    bool IsRunning() { return thread_ != NULL && SDL_AtomicGet(&quit_) == 0; }
+
+    // The number of frames presented so far.
+    unsigned GetPresentedFrames() { return (unsigned)SDL_AtomicGet(&presentedCount_); }
+
+    // The input-to-present latency of the last frame with input, and its
+    // running average, in microseconds.
+    int GetInputLatency() { return SDL_AtomicGet(&inputLatency_); }
+    int GetAverageInputLatency() { return SDL_AtomicGet(&averageInputLatency_); }
+
+    bool IsSoftware() { return software_; }
+
+    // Read the finished frames back into the capture. Set before Start().
+    void SetCapture(FrameCapture* capture) { capture_ = capture; }
+
+    // Register the render path's metrics and feed them. Set before Start().
+    void SetMetrics(Metrics* metrics);
+
+private:
+    static int SDLCALL ThreadMain(void* data);
+    bool CreateRenderer();
+    // Follow the packet's logical size and the output's pixel density.
+    bool Resize(const FramePacket& packet);
+    void Run();
+    void Draw(const FramePacket& packet);
+    void DrawLayer(const FramePacket& packet, int index);
+    // Draw into the frame, or into the layer being rendered.
+    void DrawItemTo(const DrawItem& item, CachedLayer* layer);
+    // Let go of the text slots' textures.
+    void ReleaseTexts();
+    void MeasureInputLatency(const FramePacket& packet);
+    void RecordMetrics(int frameTime, const RenderStats& stats);
+    void Destroy();
+
+    SDL_Thread*    thread_;
+    SDL_Window*    window_;
+    SDL_Renderer*  renderer_;
+    TextCache*     texts_;
+    JobSystem*     jobs_;
+    FrameCapture*  capture_;
+
+    // The texture format negotiated with the renderer.
+    TextureFormat  textureFormat_;
+
+    // The CPU composited frame used with the software renderer.
+    Framebuffer    framebuffer_;
+    bool           software_;
+
+    // The size the frames are drawn at, and the output pixels per logical
+    // pixel the renderer scales that by.
+    int            logicalWidth_;
+    int            logicalHeight_;
+    float          scale_;
+
+    // This renderer's uploads of the shared text, and the texture of each
+    // text slot, looked up again only when its text changes. After a change
+    // of pixel density a slot keeps its old texture, drawn scaled, until the
+    // text has been rasterized at the new size in the background.
+    TextTextureCache         textures_;
+    int                      textGeneration_;
+    int                      textSize_;
+    std::vector<Texture*>    textTextures_;
+    std::vector<TextRequest> textCache_;
+    std::vector<int>         textSizes_;
+    // Which text slots were rasterized again this frame.
+    std::vector<char>        textChanged_;
+
+    // What the packets' sprites are drawn with.
+    SpriteSheet    sprites_;
+    // What the packets' tilemap chunks are drawn from.
+    ChunkCache     chunks_;
+
+    // The cached layers by id.
+    std::vector<CachedLayer*> layers_;
+
+    // The performance overlay, and when the last frame was presented.
+    Hud            hud_;
+    Uint64         lastPresent_;
+    // This window's share of the render work.
+    RenderCounters counters_;
+
+    // NULL without metrics.
+    MetricHistogram* frameTimeMetric_;
+    MetricCounter*   framesMetric_;
+    MetricCounter*   drawCallsMetric_;
+    MetricCounter*   textureCreationsMetric_;
+    MetricCounter*   bytesUploadedMetric_;
+    MetricCounter*   allocationsMetric_;
+    MetricCounter*   conversionsMetric_;
+    MetricGauge*     inputLatencyMetric_;
+
+    FrameQueue     queue_;
+    // The index of the last frame submitted and the last one presented;
+    // the render thread drops a packet when a newer one replaced it.
+    unsigned       submitted_;
+    SDL_atomic_t   presented_;
+    SDL_atomic_t   presentedCount_;
+    int            maxFramesAhead_;
+
+    SDL_atomic_t   inputLatency_;
+    SDL_atomic_t   averageInputLatency_;
+    // Posted on every submit and every present.
+    SDL_sem*       packetReady_;
+    SDL_sem*       framePresented_;
+    // Posted once the renderer exists, or failed to.
+    SDL_sem*       started_;
+    bool           startOk_;
+    SDL_atomic_t   quit_;
+};
+
+#endif  // RENDER_THREAD_H_
@@ -0,0 +1,218 @@
+#include "spatial_hash.h"
+
+static const Uint32 kIndexMask = EntityStore::kMaxEntities - 1;
+
+// The rows of cells per job; a row is a handful of table lookups.
+static const int kRowGrain = 4;
+
+// Whether the rects overlap, touching edges included so points hit.
+static bool Overlaps(const SDL_FRect& a, const SDL_FRect& b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+static int FloorToCell(float value, float cellSize) { return (int)SDL_floorf(value / cellSize); }
+
+SpatialHash::SpatialHash() { Create(kGrid, 64.f); }
+
+void SpatialHash::Create(Mode mode, float cellSize)
+{
+    Clear();
+    mode_   = mode;
+    levels_ = mode == kGrid ? 1 : kLevels;
+    for (int i = 0; i < levels_; ++i) cellSizes_[i] = cellSize * (1 << (levels_ - 1 - i));
+}
+
+void SpatialHash::Clear()
+{
+    cells_.clear();
+    proxies_.clear();
+    count_ = 0;
+    for (int i = 0; i < kLevels; ++i)
+    {
+        reaches_[i]     = 0.f;
+        levelCounts_[i] = 0;
+    }
+}
+
+void SpatialHash::Update(Entity entity, const SDL_FRect& bounds)
+{
+    Uint32 index = entity & kIndexMask;
+    if (index >= proxies_.size())
+    {
+        Proxy none;
+        SDL_zero(none);
+        proxies_.resize(index + 1, none);
+    }
+
+    // The deepest level whose cells are as big as the entity; bigger ones
+    // than the top cells stay at the top and widen its reach.
+    int level = 0;
+    if (mode_ == kLooseQuadtree)
+    {
+        float size = SDL_max(bounds.w, bounds.h);
+        while (level + 1 < levels_ && cellSizes_[level + 1] >= size) ++level;
+        reaches_[level] = SDL_max(reaches_[level],
+                                  SDL_max(cellSizes_[level], size) * 0.5f);
+    }
+
+    int x0, y0, x1, y1;
+    GetCells(level, bounds, x0, y0, x1, y1);
+
+    // Moving within its cells leaves the table alone.
+    Proxy& proxy = proxies_[index];
+    proxy.bounds = bounds;
+    if (proxy.entity == entity && proxy.level == level && proxy.x0 == x0 && proxy.y0 == y0 &&
+        proxy.x1 == x1 && proxy.y1 == y1)
+        return;
+
+    // A stale handle's proxy gets taken over.
+    if (proxy.entity != 0) Unlink(index);
+    else                   ++count_;
+    proxy.entity = entity;
+    proxy.level  = level;
+    proxy.x0     = x0;
+    proxy.y0     = y0;
+    proxy.x1     = x1;
+    proxy.y1     = y1;
+    Link(index);
+}
+
+void SpatialHash::Remove(Entity entity)
+{
+    Uint32 index = entity & kIndexMask;
+    if (index >= proxies_.size() || proxies_[index].entity != entity) return;
+
+    Unlink(index);
+    proxies_[index].entity = 0;
+    --count_;
+}
+
+void SpatialHash::Query(const SDL_FRect& rect, std::vector<Entity>& result, JobSystem* jobs)
+{
+    // Every row of cells the rect reaches, on the levels holding anything.
+    rows_.clear();
+    for (int level = 0; level < levels_; ++level)
+    {
+        if (levelCounts_[level] == 0) continue;
+
+        float    cellSize = cellSizes_[level];
+        float    reach    = reaches_[level];
+        QueryRow row;
+        row.level = level;
+        row.x0    = FloorToCell(rect.x - reach, cellSize);
+        row.x1    = FloorToCell(rect.x + rect.w + reach, cellSize);
+        row.top   = FloorToCell(rect.y - reach, cellSize);
+        int y1    = FloorToCell(rect.y + rect.h + reach, cellSize);
+        for (row.y = row.top; row.y <= y1; ++row.y) rows_.push_back(row);
+    }
+
+    int count = (int)rows_.size();
+    if (jobs == NULL || count < 2 * kRowGrain)
+    {
+        for (int i = 0; i < count; ++i) VisitRow(rows_[i], rect, result);
+        return;
+    }
+
+    if ((int)rowResults_.size() < count) rowResults_.resize(count);
+    QueryJob job;
+    job.hash    = this;
+    job.rect    = rect;
+    job.rows    = &rows_[0];
+    job.results = &rowResults_[0];
+    jobs->ParallelFor(count, kRowGrain, QueryRange, &job);
+
+    for (int i = 0; i < count; ++i)
+    {
+        result.insert(result.end(), rowResults_[i].begin(), rowResults_[i].end());
+        rowResults_[i].clear();
+    }
+}
+
+Uint64 SpatialHash::GetKey(int level, int x, int y)
+{
+    // 28 bits of each coordinate; cells that far apart may share a slot,
+    // which the bounds test sorts out.
+    return ((Uint64)level << 56) | ((Uint64)(y & 0xFFFFFFF) << 28) | (Uint64)(x & 0xFFFFFFF);
+}
+
+void SpatialHash::QueryRange(void* data, int begin, int end)
+{
+    const QueryJob& job = *static_cast<QueryJob*>(data);
+    for (int i = begin; i < end; ++i) job.hash->VisitRow(job.rows[i], job.rect, job.results[i]);
+}
+
+void SpatialHash::GetCells(int level, const SDL_FRect& bounds, int& x0, int& y0, int& x1,
+                           int& y1)
+{
+    float cellSize = cellSizes_[level];
+    if (mode_ == kLooseQuadtree)
+    {
+        x0 = x1 = FloorToCell(bounds.x + bounds.w * 0.5f, cellSize);
+        y0 = y1 = FloorToCell(bounds.y + bounds.h * 0.5f, cellSize);
+        return;
+    }
+
+    x0 = FloorToCell(bounds.x, cellSize);
+    y0 = FloorToCell(bounds.y, cellSize);
+    x1 = FloorToCell(bounds.x + bounds.w, cellSize);
+    y1 = FloorToCell(bounds.y + bounds.h, cellSize);
+}
+
+void SpatialHash::Link(Uint32 index)
+{
+    const Proxy& proxy = proxies_[index];
+    for (int y = proxy.y0; y <= proxy.y1; ++y)
+    {
+        for (int x = proxy.x0; x <= proxy.x1; ++x)
+            cells_[GetKey(proxy.level, x, y)].push_back(index);
+    }
+    ++levelCounts_[proxy.level];
+}
+
+void SpatialHash::Unlink(Uint32 index)
+{
+    const Proxy& proxy = proxies_[index];
+    for (int y = proxy.y0; y <= proxy.y1; ++y)
+    {
+        for (int x = proxy.x0; x <= proxy.x1; ++x)
+        {
+            CellMap::iterator cell = cells_.find(GetKey(proxy.level, x, y));
+            if (cell == cells_.end()) continue;
+
+            // Cells are short; swap the index out of its one.
+            std::vector<Uint32>& indices = cell->second;
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                if (indices[i] != index) continue;
+                indices[i] = indices.back();
+                indices.pop_back();
+                break;
+            }
+            if (indices.empty()) cells_.erase(cell);
+        }
+    }
+    --levelCounts_[proxy.level];
+}
+
+void SpatialHash::VisitRow(const QueryRow& row, const SDL_FRect& rect,
+                           std::vector<Entity>& result)
+{
+    for (int x = row.x0; x <= row.x1; ++x)
+    {
+        CellMap::const_iterator cell = cells_.find(GetKey(row.level, x, row.y));
+        if (cell == cells_.end()) continue;
+
+        const std::vector<Uint32>& indices = cell->second;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            const Proxy& proxy = proxies_[indices[i]];
+            // A grid entity over several cells is only taken from the first
+            // of them the query visits.
+            if (mode_ == kGrid &&
+                (x != SDL_max(proxy.x0, row.x0) || row.y != SDL_max(proxy.y0, row.top)))
+                continue;
+            if (Overlaps(proxy.bounds, rect)) result.push_back(proxy.entity);
+        }
+    }
+}
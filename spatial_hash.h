@@ -0,0 +1,121 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "entity_store.h"
+#include "job_system.h"
+
+// A broadphase over the bounds of entities, for culling draws against the
+// view and picking under the mouse. Cells live in a hash table, so the world
+// has no edges and empty space costs nothing; a query only visits the cells
+// it overlaps and the entities in them.
+//
+// kGrid keeps one level of uniform cells and puts an entity into every cell
+// its bounds touch. kLooseQuadtree keeps one hashed level per depth of a
+// quadtree, each with half the cell size of the one above, and puts an entity
+// into the single cell of the deepest level that is at least as big as it,
+// by its center; queries reach half a cell further so entities sticking out
+// of their cell are still found. Big entities cost one insertion there
+// instead of many.
+//
+// Moving an entity only touches the table when it changes cells. Updates are
+// for the game thread; queries only read, and split their cells across the
+// jobs.
+class SpatialHash
+{
+public:
+    enum Mode
+    {
+        kGrid,
+        kLooseQuadtree
+    };
+
+    // The depths of a loose quadtree; the top cells are 2^(kLevels - 1)
+    // times the size given.
+    static const int kLevels = 8;
+
+    SpatialHash();
+
+    // The size of a grid cell or of the smallest quadtree cells, in pixels.
+    void Create(Mode mode, float cellSize);
+    void Clear();
+
+    // Add the entity, or move it when it's already in.
+    void Update(Entity entity, const SDL_FRect& bounds);
+    void Remove(Entity entity);
+
+    int GetCount() { return count_; }
+
+    // Append the entities whose bounds overlap the rect, each once, in no
+    // particular order. A point is a rect of no size.
+    void Query(const SDL_FRect& rect, std::vector<Entity>& result, JobSystem* jobs);
+
+private:
+    struct Proxy
+    {
+        // 0 when the index isn't in.
+        Entity    entity;
+        SDL_FRect bounds;
+        // The cells covered, a single one in a loose quadtree.
+        int       level;
+        int       x0;
+        int       y0;
+        int       x1;
+        int       y1;
+    };
+
+    // A row of cells of a level that a query visits, and the query's top
+    // row of that level.
+    struct QueryRow
+    {
+        int level;
+        int y;
+        int x0;
+        int x1;
+        int top;
+    };
+
+    struct QueryJob
+    {
+        SpatialHash*         hash;
+        SDL_FRect            rect;
+        const QueryRow*      rows;
+        // A result per row, so the jobs never share one.
+        std::vector<Entity>* results;
+    };
+
+    typedef std::unordered_map<Uint64, std::vector<Uint32> > CellMap;
+
+    static Uint64 GetKey(int level, int x, int y);
+    static void   QueryRange(void* data, int begin, int end);
+
+    // The cells of the level the bounds cover, for a loose quadtree just the
+    // one of their center.
+    void GetCells(int level, const SDL_FRect& bounds, int& x0, int& y0, int& x1, int& y1);
+    void Link(Uint32 index);
+    void Unlink(Uint32 index);
+    void VisitRow(const QueryRow& row, const SDL_FRect& rect, std::vector<Entity>& result);
+
+    Mode                  mode_;
+    // By level, the deepest last: the cell size, how far past its cells the
+    // entities in it may reach, and how many there are.
+    float                 cellSizes_[kLevels];
+    float                 reaches_[kLevels];
+    int                   levelCounts_[kLevels];
+    int                   levels_;
+
+    CellMap               cells_;
+    // By entity index.
+    std::vector<Proxy>    proxies_;
+    int                   count_;
+
+    // Kept across queries for their memory.
+    std::vector<QueryRow>              rows_;
+    std::vector<std::vector<Entity> >  rowResults_;
+};
+
+#endif  // SPATIAL_HASH_H_
@@ -0,0 +1,177 @@
+#include "sprite_sheet.h"
+
+#include "render_stats.h"
+
+// Whether a point, in sprite units of -1 to 1 from the center, is inside the
+// sprite's shape.
+static bool IsInside(int sprite, float x, float y)
+{
+    float distance = x * x + y * y;
+    if (sprite >= SpriteSheet::kSpin)
+    {
+        float angle = (sprite - SpriteSheet::kSpin) * (float)M_PI / 2 / SpriteSheet::kSpinFrames;
+        float c     = SDL_cosf(angle);
+        float s     = SDL_sinf(angle);
+        return SDL_fabs(c * x + s * y) <= 0.65f && SDL_fabs(c * y - s * x) <= 0.65f;
+    }
+    if (sprite >= SpriteSheet::kPulse)
+    {
+        float radius = 0.45f + 0.15f * (sprite - SpriteSheet::kPulse);
+        return distance <= radius * radius;
+    }
+
+    switch (sprite)
+    {
+    case SpriteSheet::kSquare:  return SDL_fabs(x) <= 0.8f && SDL_fabs(y) <= 0.8f;
+    case SpriteSheet::kDisc:    return distance <= 0.9f * 0.9f;
+    case SpriteSheet::kDiamond: return SDL_fabs(x) + SDL_fabs(y) <= 0.95f;
+    case SpriteSheet::kRing:    return distance <= 0.9f * 0.9f && distance >= 0.5f * 0.5f;
+    }
+    return false;
+}
+
+SpriteSheet::SpriteSheet() : texture_(NULL), surface_(NULL), premultiplied_(false) {}
+
+SpriteSheet::~SpriteSheet() { Free(); }
+
+bool SpriteSheet::Create(SDL_Renderer* renderer, TextureFormat& format)
+{
+    Free();
+
+    SDL_Surface* sheet = Rasterize();
+    if (sheet == NULL) return false;
+
+    // The software renderer composites from premultiplied surfaces.
+    if (format.IsSoftware())
+    {
+        CountTextureCreation();
+        surface_ = sheet;
+        if (!PremultiplySurface(surface_))
+        {
+            Free();
+            return false;
+        }
+        return true;
+    }
+
+    texture_       = format.CreateTexture(renderer, sheet);
+    premultiplied_ = format.IsPremultiplied();
+    SDL_FreeSurface(sheet);
+
+    return texture_ != NULL;
+}
+
+void SpriteSheet::Free()
+{
+    if (texture_ != NULL) SDL_DestroyTexture(texture_);
+    if (surface_ != NULL) SDL_FreeSurface(surface_);
+
+    texture_ = NULL;
+    surface_ = NULL;
+}
+
+void SpriteSheet::Draw(SDL_Renderer* renderer, const FramePacket& packet, int first, int count)
+{
+    if (texture_ == NULL) return;
+
+    // Turned sprites reach out to their corners.
+    const SpriteBatch& batch = packet.sprites;
+    float              size  = kSpriteSize * packet.viewScale;
+    float              reach = packet.viewAngle == 0.f ? size / 2.f : size * 0.7072f;
+    float              right = packet.width + reach;
+    float              down  = packet.height + reach;
+
+    // The modulation only changes along with the color; SDL batches the
+    // copies in between.
+    SDL_Color last  = {0, 0, 0, 0};
+    bool      set   = false;
+    int       drawn = 0;
+    for (int i = first; i < first + count; ++i)
+    {
+        float x = batch.x[i];
+        float y = batch.y[i];
+        if (x < -reach || y < -reach || x > right || y > down) continue;
+
+        SDL_Color color = batch.colors[i];
+        if (!set || SDL_memcmp(&color, &last, sizeof(SDL_Color)) != 0)
+        {
+            Uint8 r = color.r;
+            Uint8 g = color.g;
+            Uint8 b = color.b;
+            if (premultiplied_)
+            {
+                r = (Uint8)(r * color.a / 255);
+                g = (Uint8)(g * color.a / 255);
+                b = (Uint8)(b * color.a / 255);
+            }
+            SDL_SetTextureColorMod(texture_, r, g, b);
+            SDL_SetTextureAlphaMod(texture_, color.a);
+            last = color;
+            set  = true;
+        }
+
+        // Placed to the subpixel.
+        SDL_Rect  srcRect  = {batch.ids[i] * kSpriteSize, 0, kSpriteSize, kSpriteSize};
+        SDL_FRect destRect = {x - size / 2.f, y - size / 2.f, size, size};
+        if (packet.viewAngle == 0.f) SDL_RenderCopyF(renderer, texture_, &srcRect, &destRect);
+        else
+            SDL_RenderCopyExF(renderer, texture_, &srcRect, &destRect, packet.viewAngle, NULL,
+                              SDL_FLIP_NONE);
+        ++drawn;
+    }
+    CountDrawCalls(drawn);
+}
+
+void SpriteSheet::Draw(Framebuffer& framebuffer, const FramePacket& packet, int first, int count)
+{
+    if (surface_ == NULL) return;
+
+    const SpriteBatch& batch = packet.sprites;
+    for (int i = first; i < first + count; ++i)
+    {
+        int x = (int)SDL_floorf(batch.x[i]) - kSpriteSize / 2;
+        int y = (int)SDL_floorf(batch.y[i]) - kSpriteSize / 2;
+        if (x <= -kSpriteSize || y <= -kSpriteSize || x >= packet.width || y >= packet.height)
+            continue;
+
+        SDL_Rect srcRect = {batch.ids[i] * kSpriteSize, 0, kSpriteSize, kSpriteSize};
+        framebuffer.BlitTinted(surface_, srcRect, x, y, batch.colors[i]);
+    }
+}
+
+SDL_Surface* SpriteSheet::Rasterize()
+{
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, kSpriteSize * kSpriteCount,
+                                                        kSpriteSize, 32,
+                                                        SDL_PIXELFORMAT_ARGB8888);
+    if (sheet == NULL) return NULL;
+
+    // White, with the coverage of 4x4 samples per pixel as alpha.
+    const int kSamples = 4;
+    for (int sprite = 0; sprite < kSpriteCount; ++sprite)
+    {
+        for (int y = 0; y < kSpriteSize; ++y)
+        {
+            Uint32* row = (Uint32*)((Uint8*)sheet->pixels + y * sheet->pitch) +
+                          sprite * kSpriteSize;
+            for (int x = 0; x < kSpriteSize; ++x)
+            {
+                int covered = 0;
+                for (int sy = 0; sy < kSamples; ++sy)
+                {
+                    for (int sx = 0; sx < kSamples; ++sx)
+                    {
+                        float px = (x + (sx + 0.5f) / kSamples) * 2.f / kSpriteSize - 1.f;
+                        float py = (y + (sy + 0.5f) / kSamples) * 2.f / kSpriteSize - 1.f;
+                        if (IsInside(sprite, px, py)) ++covered;
+                    }
+                }
+
+                Uint32 alpha = (Uint32)(covered * 255 / (kSamples * kSamples));
+                row[x]       = (alpha << 24) | 0xFFFFFF;
+            }
+        }
+    }
+
+    return sheet;
+}
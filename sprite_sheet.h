@@ -0,0 +1,59 @@
+#ifndef SPRITE_SHEET_H_
+#define SPRITE_SHEET_H_
+
+#include "SDL2/SDL.h"
+
+#include "frame_packet.h"
+#include "framebuffer.h"
+#include "texture_format.h"
+
+// The sprites the entities are drawn with: white antialiased shapes on one
+// sheet, tinted by each sprite's color as it's drawn.
+class SpriteSheet
+{
+public:
+    // The edge of a sprite in pixels.
+    static const int kSpriteSize = 16;
+    // The frames of the flipbook sprites.
+    static const int kPulseFrames = 4;
+    static const int kSpinFrames  = 4;
+
+    // The still shapes, then a disc growing frame by frame and a square
+    // turning a quarter around.
+    enum Sprite
+    {
+        kSquare,
+        kDisc,
+        kDiamond,
+        kRing,
+        kShapeCount,
+        kPulse       = kShapeCount,
+        kSpin        = kPulse + kPulseFrames,
+        kSpriteCount = kSpin + kSpinFrames
+    };
+
+    SpriteSheet();
+    ~SpriteSheet();
+
+    bool Create(SDL_Renderer* renderer, TextureFormat& format);
+    void Free();
+
+    // Draw count sprites of the packet's batch from first, centered on their
+    // positions and zoomed and turned by the packet's view. The ones off
+    // screen are skipped before reaching SDL. The software renderer can't
+    // zoom or turn.
+    void Draw(SDL_Renderer* renderer, const FramePacket& packet, int first, int count);
+    void Draw(Framebuffer& framebuffer, const FramePacket& packet, int first, int count);
+
+private:
+    // The straight alpha ARGB8888 sheet.
+    static SDL_Surface* Rasterize();
+
+    SDL_Texture* texture_;
+    // The premultiplied sheet kept instead of a texture for software rendering.
+    SDL_Surface* surface_;
+    // Whether the texture's color modulation has to be premultiplied too.
+    bool         premultiplied_;
+};
+
+#endif  // SPRITE_SHEET_H_
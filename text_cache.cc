@@ -0,0 +1,297 @@
+#include "text_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+bool TextKeyLess::operator()(const TextKey& a, const TextKey& b) const
+{
+    int order = a.request.text.compare(b.request.text);
+    if (order != 0) return order < 0;
+    order = SDL_memcmp(&a.request.color, &b.request.color, sizeof(SDL_Color));
+    if (order != 0) return order < 0;
+    return a.size < b.size;
+}
+
+TextCache::TextCache()
+    : font_(NULL), watcher_(NULL), jobs_(NULL), lock_(NULL), fontLock_(NULL), tick_(0)
+{
+    SDL_AtomicSet(&generation_, 0);
+}
+
+TextCache::~TextCache() { Free(); }
+
+bool TextCache::Init(FontAsset* font, AssetWatcher* watcher, JobSystem* jobs)
+{
+    font_     = font;
+    watcher_  = watcher;
+    jobs_     = jobs;
+    lock_     = SDL_CreateMutex();
+    fontLock_ = SDL_CreateMutex();
+    return lock_ != NULL && fontLock_ != NULL;
+}
+
+void TextCache::Free()
+{
+    if (jobs_ != NULL) jobs_->Wait(&rasterJobs_);
+
+    if (lock_ != NULL)
+    {
+        Clear();
+        SDL_DestroyMutex(lock_);
+    }
+    if (fontLock_ != NULL) SDL_DestroyMutex(fontLock_);
+
+    lock_     = NULL;
+    fontLock_ = NULL;
+}
+
+bool TextCache::PollReloads()
+{
+    if (watcher_ == NULL) return false;
+
+    SDL_LockMutex(fontLock_);
+    bool changed = watcher_->Poll() > 0;
+    SDL_UnlockMutex(fontLock_);
+
+    if (changed)
+    {
+        SDL_LockMutex(lock_);
+        Clear();
+        SDL_AtomicAdd(&generation_, 1);
+        SDL_UnlockMutex(lock_);
+    }
+
+    return changed;
+}
+
+SDL_Surface* TextCache::Acquire(const TextRequest& request, int size)
+{
+    TextKey key = {request, size};
+
+    SDL_LockMutex(lock_);
+    SDL_Surface* surface = Insert(key, NULL, 0, true);
+    SDL_UnlockMutex(lock_);
+    if (surface != NULL) return surface;
+
+    // Rasterize without holding up the lookups of the other windows.
+    int generation = GetGeneration();
+    surface        = Rasterize(key);
+    if (surface == NULL) return NULL;
+
+    SDL_LockMutex(lock_);
+    surface = Insert(key, surface, generation, true);
+    SDL_UnlockMutex(lock_);
+
+    return surface;
+}
+
+SDL_Surface* TextCache::TryAcquire(const TextRequest& request, int size)
+{
+    TextKey key = {request, size};
+
+    SDL_LockMutex(lock_);
+    SDL_Surface* surface = Insert(key, NULL, 0, true);
+    bool         queue   = surface == NULL && entries_.find(key) == entries_.end();
+    if (queue)
+    {
+        // Mark the text as queued so it's only rasterized once.
+        Entry entry = {NULL, ++tick_};
+        entries_.insert(EntryMap::value_type(key, entry));
+    }
+    SDL_UnlockMutex(lock_);
+
+    if (queue)
+    {
+        RasterJob* job  = new RasterJob;
+        job->cache      = this;
+        job->key        = key;
+        job->generation = GetGeneration();
+        jobs_->Schedule(RunRasterJob, job, &rasterJobs_);
+    }
+
+    return surface;
+}
+
+void TextCache::Release(SDL_Surface* surface)
+{
+    if (surface == NULL) return;
+
+    // The reference count isn't atomic.
+    SDL_LockMutex(lock_);
+    SDL_FreeSurface(surface);
+    SDL_UnlockMutex(lock_);
+}
+
+void TextCache::RunRasterJob(void* data)
+{
+    RasterJob* job   = static_cast<RasterJob*>(data);
+    TextCache* cache = job->cache;
+
+    SDL_Surface* surface = cache->Rasterize(job->key);
+
+    SDL_LockMutex(cache->lock_);
+    EntryMap::iterator it = cache->entries_.find(job->key);
+    if (surface != NULL) cache->Insert(job->key, surface, job->generation, false);
+    // A text that can't be rasterized may be queued again.
+    else if (it != cache->entries_.end() && it->second.surface == NULL) cache->entries_.erase(it);
+    SDL_UnlockMutex(cache->lock_);
+
+    delete job;
+}
+
+SDL_Surface* TextCache::Rasterize(const TextKey& key)
+{
+    SDL_LockMutex(fontLock_);
+    TTF_Font*    font    = font_->Get(key.size);
+    SDL_Surface* surface = NULL;
+    if (font != NULL)
+        surface = TTF_RenderUTF8_Blended(font, key.request.text.c_str(), key.request.color);
+    SDL_UnlockMutex(fontLock_);
+
+    return surface;
+}
+
+SDL_Surface* TextCache::Insert(const TextKey& key, SDL_Surface* surface, int generation,
+                               bool acquire)
+{
+    EntryMap::iterator it = entries_.find(key);
+
+    if (it != entries_.end() && it->second.surface != NULL)
+    {
+        // Whoever finished first wins.
+        if (surface != NULL) SDL_FreeSurface(surface);
+        surface = it->second.surface;
+    }
+    else if (surface == NULL) return NULL;
+    else if (generation != GetGeneration())
+    {
+        // A surface of the old font is only good for the caller.
+        if (acquire) return surface;
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+    else if (it == entries_.end())
+    {
+        Entry entry = {surface, 0};
+        it = entries_.insert(EntryMap::value_type(key, entry)).first;
+    }
+    else it->second.surface = surface;
+
+    if (!acquire) return NULL;
+
+    // The caller's reference; SDL_FreeSurface() only frees the last one.
+    ++surface->refcount;
+    it->second.lastUse = ++tick_;
+    Evict();
+    return surface;
+}
+
+bool TextCache::UsedEarlier(EntryMap::iterator a, EntryMap::iterator b)
+{
+    return a->second.lastUse < b->second.lastUse;
+}
+
+void TextCache::Evict()
+{
+    if ((int)entries_.size() <= kMaxEntries) return;
+
+    // Rare enough to just sort the idle entries by last use.
+    std::vector<EntryMap::iterator> idle;
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        SDL_Surface* surface = it->second.surface;
+        if (surface != NULL && surface->refcount == 1) idle.push_back(it);
+    }
+    std::sort(idle.begin(), idle.end(), UsedEarlier);
+
+    size_t evict = SDL_min(idle.size(), entries_.size() - kMaxEntries / 2);
+    for (size_t i = 0; i < evict; ++i)
+    {
+        SDL_FreeSurface(idle[i]->second.surface);
+        entries_.erase(idle[i]);
+    }
+}
+
+void TextCache::Clear()
+{
+    // Surfaces still held elsewhere live on until released; queued texts
+    // are dropped when they come in.
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        if (it->second.surface != NULL) SDL_FreeSurface(it->second.surface);
+    entries_.clear();
+}
+
+TextTextureCache::TextTextureCache() : renderer_(NULL), format_(NULL), texts_(NULL) {}
+
+TextTextureCache::~TextTextureCache() { Clear(); }
+
+void TextTextureCache::Init(SDL_Renderer* renderer, TextureFormat* format, TextCache* texts)
+{
+    renderer_ = renderer;
+    format_   = format;
+    texts_    = texts;
+}
+
+Texture* TextTextureCache::Acquire(const TextRequest& request, int size)
+{
+    TextKey            key = {request, size};
+    EntryMap::iterator it  = entries_.find(key);
+    if (it != entries_.end())
+    {
+        ++it->second.refs;
+        return it->second.texture;
+    }
+
+    return Upload(key, texts_->Acquire(request, size));
+}
+
+Texture* TextTextureCache::TryAcquire(const TextRequest& request, int size)
+{
+    TextKey            key = {request, size};
+    EntryMap::iterator it  = entries_.find(key);
+    if (it != entries_.end())
+    {
+        ++it->second.refs;
+        return it->second.texture;
+    }
+
+    return Upload(key, texts_->TryAcquire(request, size));
+}
+
+void TextTextureCache::Release(const TextRequest& request, int size)
+{
+    TextKey            key = {request, size};
+    EntryMap::iterator it  = entries_.find(key);
+    if (it == entries_.end() || --it->second.refs > 0) return;
+
+    delete it->second.texture;
+    entries_.erase(it);
+}
+
+void TextTextureCache::Clear()
+{
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        delete it->second.texture;
+    entries_.clear();
+}
+
+Texture* TextTextureCache::Upload(const TextKey& key, SDL_Surface* surface)
+{
+    if (surface == NULL) return NULL;
+
+    // Text rasterized larger than the font's size is drawn scaled down by as
+    // much, so it keeps its size in logical pixels.
+    Texture* texture = new Texture;
+    bool     ok      = texture->LoadFromSurface(renderer_, *format_, surface,
+                                                (float)key.size / texts_->GetFontSize());
+    texts_->Release(surface);
+    if (!ok)
+    {
+        delete texture;
+        return NULL;
+    }
+
+    Entry entry = {texture, 1};
+    entries_.insert(EntryMap::value_type(key, entry));
+    return texture;
+}
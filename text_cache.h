@@ -0,0 +1,143 @@
+#ifndef TEXT_CACHE_H_
+#define TEXT_CACHE_H_
+
+#include <map>
+#include <string>
+
+#include "SDL2/SDL.h"
+
+#include "asset_watcher.h"
+#include "frame_packet.h"
+#include "job_system.h"
+#include "texture.h"
+#include "texture_format.h"
+
+// A text request rasterized at a font size, in pixels.
+struct TextKey
+{
+    TextRequest request;
+    int         size;
+};
+
+// Orders text keys by text, then color, then size.
+struct TextKeyLess
+{
+    bool operator()(const TextKey& a, const TextKey& b) const;
+};
+
+// The rasterized text shared by every window. Each text, color and size is
+// rasterized once, whichever render thread asks first. FreeType isn't
+// thread-safe, so rasterizing and swapping in a reloaded font are serialized
+// by a lock of their own; lookups only take the lock of the entries and never
+// wait for a rasterization.
+class TextCache
+{
+public:
+    // The unused surfaces kept around.
+    static const int kMaxEntries = 256;
+
+    TextCache();
+    ~TextCache();
+
+    // The watcher is optional; whichever render thread polls it first swaps
+    // in the reloaded font. Rasterizations in the background run on the jobs.
+    bool Init(FontAsset* font, AssetWatcher* watcher, JobSystem* jobs);
+    // Waits for the background rasterizations, call before the jobs shut down.
+    void Free();
+
+    // Swap in reloaded assets. Returns true when the font changed.
+    bool PollReloads();
+    // Bumped on every font change; everything rasterized before is stale.
+    int GetGeneration() { return SDL_AtomicGet(&generation_); }
+
+    // The size the font was loaded at.
+    int GetFontSize() { return font_->GetSize(); }
+
+    // The straight alpha ARGB8888 surface of the text, rasterized on first
+    // use; NULL when it can't be. The surface is shared and read-only, hand
+    // it back with Release().
+    SDL_Surface* Acquire(const TextRequest& request, int size);
+    // Like Acquire(), but never rasterizes on the calling thread: a text not
+    // rasterized yet gets queued on the jobs and NULL comes back until it's
+    // done.
+    SDL_Surface* TryAcquire(const TextRequest& request, int size);
+    void Release(SDL_Surface* surface);
+
+private:
+    struct Entry
+    {
+        // NULL while queued.
+        SDL_Surface* surface;
+        unsigned     lastUse;
+    };
+
+    struct RasterJob
+    {
+        TextCache* cache;
+        TextKey    key;
+        int        generation;
+    };
+
+    typedef std::map<TextKey, Entry, TextKeyLess> EntryMap;
+
+    static void RunRasterJob(void* data);
+    SDL_Surface* Rasterize(const TextKey& key);
+    // Add the rasterized surface unless the font changed meanwhile, and take
+    // a reference for the caller on request. Under the lock.
+    SDL_Surface* Insert(const TextKey& key, SDL_Surface* surface, int generation, bool acquire);
+    // Drop the least recently used surfaces nobody holds. Under the lock.
+    void Evict();
+    static bool UsedEarlier(EntryMap::iterator a, EntryMap::iterator b);
+    void Clear();
+
+    EntryMap       entries_;
+    FontAsset*     font_;
+    AssetWatcher*  watcher_;
+    JobSystem*     jobs_;
+    // The lock of the entries, and the one serializing FreeType.
+    SDL_mutex*     lock_;
+    SDL_mutex*     fontLock_;
+    unsigned       tick_;
+    SDL_atomic_t   generation_;
+    JobCounter     rasterJobs_;
+};
+
+// One renderer's textures of the shared text: the slots showing the same
+// text, color and size share a single upload. Only touched by the render
+// thread.
+class TextTextureCache
+{
+public:
+    TextTextureCache();
+    ~TextTextureCache();
+
+    void Init(SDL_Renderer* renderer, TextureFormat* format, TextCache* texts);
+
+    // The texture of the text at the size, uploaded on first use; NULL when
+    // it can't be. Every Acquire() needs a Release().
+    Texture* Acquire(const TextRequest& request, int size);
+    // NULL until the shared cache has the text rasterized at the size.
+    Texture* TryAcquire(const TextRequest& request, int size);
+    void Release(const TextRequest& request, int size);
+
+    // Destroy every texture, the next Acquire() uploads again.
+    void Clear();
+
+private:
+    struct Entry
+    {
+        Texture* texture;
+        int      refs;
+    };
+
+    typedef std::map<TextKey, Entry, TextKeyLess> EntryMap;
+
+    Texture* Upload(const TextKey& key, SDL_Surface* surface);
+
+    EntryMap       entries_;
+    SDL_Renderer*  renderer_;
+    TextureFormat* format_;
+    TextCache*     texts_;
+};
+
+#endif  // TEXT_CACHE_H_
@@ -1,23 +1,34 @@
 #include "texture.h"
 
-Texture::Texture() : texture_(NULL), width_(0), height_(0) {}
+#include "render_stats.h"
+
+Texture::Texture() : texture_(NULL), surface_(NULL), width_(0), height_(0) {}
 
 Texture::~Texture() { Free(); }
 
-bool Texture::LoadFromRenderedText(SDL_Renderer* renderer, TTF_Font* font,
-                                   std::string text, SDL_Color color)
+bool Texture::LoadFromSurface(SDL_Renderer* renderer, TextureFormat& format,
+                              const SDL_Surface* surface, float scale)
 {
-    SDL_Surface* surf = TTF_RenderUTF8_Blended(font, text.c_str(), color);
-    if (surf == NULL) return false;
-
-    if (texture_ != NULL) SDL_DestroyTexture(texture_);
-    texture_ = SDL_CreateTextureFromSurface(renderer, surf);
-    if (texture_ == NULL) return false;
-    width_  = surf->w;
-    height_ = surf->h;
-
-    SDL_FreeSurface(surf);
-    return true;
+    Free();
+    width_  = (int)(surface->w / scale + 0.5f);
+    height_ = (int)(surface->h / scale + 0.5f);
+
+    // The software renderer composites from premultiplied surfaces.
+    if (format.IsSoftware())
+    {
+        CountTextureCreation();
+        surface_ = SDL_DuplicateSurface(const_cast<SDL_Surface*>(surface));
+        if (surface_ == NULL || !PremultiplySurface(surface_))
+        {
+            Free();
+            return false;
+        }
+        return true;
+    }
+
+    texture_ = format.CreateTexture(renderer, surface);
+
+    return texture_ != NULL;
 }
 
 void Texture::Render(SDL_Renderer* renderer, int x, int y, SDL_Rect* srcRect)
@@ -25,9 +36,24 @@ void Texture::Render(SDL_Renderer* renderer, int x, int y, SDL_Rect* srcRect)
     SDL_Rect destRect = {x, y, width_, height_};
 
     SDL_RenderCopy(renderer, texture_, srcRect, &destRect);
+    CountDrawCalls(1);
+}
+
+void Texture::Render(Framebuffer& framebuffer, int x, int y, SDL_Rect* srcRect)
+{
+    if (surface_ != NULL) framebuffer.Blit(surface_, srcRect, x, y);
+}
+
+void Texture::Render(CachedLayer& layer, int x, int y, SDL_Rect* srcRect)
+{
+    if (surface_ != NULL) layer.Blit(surface_, srcRect, x, y);
 }
 
 void Texture::Free()
 {
-    SDL_DestroyTexture(texture_);
+    if (texture_ != NULL) SDL_DestroyTexture(texture_);
+    if (surface_ != NULL) SDL_FreeSurface(surface_);
+
+    texture_ = NULL;
+    surface_ = NULL;
 }
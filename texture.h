@@ -1,10 +1,11 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
-#include <string>
-
 #include "SDL2/SDL.h"
-#include "SDL2/SDL_ttf.h"
+
+#include "cached_layer.h"
+#include "framebuffer.h"
+#include "texture_format.h"
 
 class Texture
 {
@@ -12,13 +13,21 @@ public:
     Texture();
     ~Texture();
 
-    bool LoadFromRenderedText(SDL_Renderer* renderer, TTF_Font* font,
-                              std::string text, SDL_Color color);
+    // Upload a straight alpha ARGB8888 surface, which stays the caller's.
+    // Its pixels are drawn scale times smaller than they are.
+    bool LoadFromSurface(SDL_Renderer* renderer, TextureFormat& format,
+                         const SDL_Surface* surface, float scale = 1.f);
     void Render(SDL_Renderer* renderer, int x, int y, SDL_Rect* srcRect = NULL);
+    // Composite into the software framebuffer.
+    void Render(Framebuffer& framebuffer, int x, int y, SDL_Rect* srcRect = NULL);
+    // Render into a software layer, relative to its top left.
+    void Render(CachedLayer& layer, int x, int y, SDL_Rect* srcRect = NULL);
     void Free();
 
 private:
     SDL_Texture* texture_;
+    // The premultiplied pixels kept instead of a texture for software rendering.
+    SDL_Surface* surface_;
     int          width_;
     int          height_;
 };
@@ -0,0 +1,92 @@
+#include "texture_format.h"
+
+#include "blitter.h"
+#include "render_stats.h"
+
+// The 32-bit formats with alpha the rasterizers can write.
+static bool IsWritableFormat(Uint32 format)
+{
+    return format == SDL_PIXELFORMAT_ARGB8888 || format == SDL_PIXELFORMAT_ABGR8888 ||
+           format == SDL_PIXELFORMAT_RGBA8888 || format == SDL_PIXELFORMAT_BGRA8888;
+}
+
+SDL_BlendMode GetPremultipliedBlendMode()
+{
+    return SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+TextureFormat::TextureFormat()
+    : format_(SDL_PIXELFORMAT_ARGB8888), native_(false), premultiplied_(false),
+      blendMode_(SDL_BLENDMODE_BLEND), software_(false)
+{
+}
+
+void TextureFormat::Negotiate(SDL_Renderer* renderer)
+{
+    format_        = SDL_PIXELFORMAT_ARGB8888;
+    native_        = false;
+    premultiplied_ = false;
+    blendMode_     = SDL_BLENDMODE_BLEND;
+    software_      = false;
+
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0) return;
+
+    // SDL's software renderer has no custom blend modes; the framebuffer
+    // premultiplies its own surfaces.
+    software_ = (info.flags & SDL_RENDERER_SOFTWARE) != 0;
+    if (software_)
+    {
+        native_ = true;
+        return;
+    }
+
+    // The renderer lists its best formats first.
+    for (Uint32 i = 0; i < info.num_texture_formats; ++i)
+    {
+        if (!IsWritableFormat(info.texture_formats[i])) continue;
+        format_ = info.texture_formats[i];
+        native_ = true;
+        break;
+    }
+
+    // Try the premultiplied blend mode on a scratch texture.
+    SDL_Texture* probe = SDL_CreateTexture(renderer, format_, SDL_TEXTUREACCESS_STATIC, 1, 1);
+    if (probe != NULL)
+    {
+        if (SDL_SetTextureBlendMode(probe, GetPremultipliedBlendMode()) == 0)
+        {
+            premultiplied_ = true;
+            blendMode_     = GetPremultipliedBlendMode();
+        }
+        SDL_DestroyTexture(probe);
+    }
+}
+
+SDL_Texture* TextureFormat::CreateTexture(SDL_Renderer* renderer, const SDL_Surface* surface)
+{
+    SDL_Surface* pixels = SDL_CreateRGBSurfaceWithFormat(0, surface->w, surface->h, 32, format_);
+    if (pixels == NULL) return NULL;
+
+    SDL_Texture* texture = NULL;
+    if (ConvertSurface(surface, pixels, premultiplied_))
+    {
+        texture = SDL_CreateTexture(renderer, format_, SDL_TEXTUREACCESS_STATIC, surface->w,
+                                    surface->h);
+    }
+    if (texture != NULL)
+    {
+        SDL_UpdateTexture(texture, NULL, pixels->pixels, pixels->pitch);
+        SDL_SetTextureBlendMode(texture, blendMode_);
+
+        CountTextureCreation();
+        CountUpload(pixels->h * pixels->pitch);
+        // SDL converts every upload to a format the renderer doesn't take.
+        if (!native_) CountConversion();
+    }
+
+    SDL_FreeSurface(pixels);
+    return texture;
+}
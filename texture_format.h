@@ -0,0 +1,39 @@
+#ifndef TEXTURE_FORMAT_H_
+#define TEXTURE_FORMAT_H_
+
+#include "SDL2/SDL.h"
+
+// The texture format a renderer takes as is, negotiated once from
+// SDL_GetRendererInfo. Rasterized pixels get written in that format, and
+// premultiplied when the renderer can blend that, so SDL never converts on
+// upload.
+class TextureFormat
+{
+public:
+    TextureFormat();
+
+    void Negotiate(SDL_Renderer* renderer);
+
+    Uint32        GetFormat() { return format_; }
+    bool          IsNative() { return native_; }
+    bool          IsPremultiplied() { return premultiplied_; }
+    SDL_BlendMode GetBlendMode() { return blendMode_; }
+    // Software rendering composites premultiplied ARGB8888 surfaces instead
+    // of textures.
+    bool          IsSoftware() { return software_; }
+
+    // A static texture of the ARGB8888 surface, converted in one pass.
+    SDL_Texture* CreateTexture(SDL_Renderer* renderer, const SDL_Surface* surface);
+
+private:
+    Uint32        format_;
+    bool          native_;
+    bool          premultiplied_;
+    SDL_BlendMode blendMode_;
+    bool          software_;
+};
+
+// Blends premultiplied colors: dst = src + dst * (1 - src.a).
+SDL_BlendMode GetPremultipliedBlendMode();
+
+#endif  // TEXTURE_FORMAT_H_
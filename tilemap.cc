@@ -0,0 +1,83 @@
+#include "tilemap.h"
+
+// Rounded down, also for negative numbers.
+static int FloorDiv(int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+Tilemap::Tilemap() : chunksX_(0), chunksY_(0), nextVersion_(1) {}
+
+bool Tilemap::Create(int width, int height)
+{
+    if (width <= 0 || height <= 0) return false;
+
+    chunksX_ = (width + TileChunk::kTiles - 1) / TileChunk::kTiles;
+    chunksY_ = (height + TileChunk::kTiles - 1) / TileChunk::kTiles;
+    chunks_.resize(chunksX_ * chunksY_);
+    for (int y = 0; y < chunksY_; ++y)
+    {
+        for (int x = 0; x < chunksX_; ++x)
+        {
+            TileChunk& chunk = chunks_[y * chunksX_ + x];
+            chunk.x          = x;
+            chunk.y          = y;
+            chunk.version    = nextVersion_++;
+            SDL_zero(chunk.tiles);
+        }
+    }
+
+    return true;
+}
+
+void Tilemap::Free()
+{
+    chunks_.clear();
+    chunksX_ = 0;
+    chunksY_ = 0;
+}
+
+Uint8 Tilemap::GetTile(int x, int y)
+{
+    TileChunk* chunk = GetChunk(FloorDiv(x, TileChunk::kTiles), FloorDiv(y, TileChunk::kTiles));
+    if (chunk == NULL) return 0;
+
+    return chunk->tiles[(y % TileChunk::kTiles) * TileChunk::kTiles + x % TileChunk::kTiles];
+}
+
+void Tilemap::SetTile(int x, int y, Uint8 tile)
+{
+    TileChunk* chunk = GetChunk(FloorDiv(x, TileChunk::kTiles), FloorDiv(y, TileChunk::kTiles));
+    if (chunk == NULL) return;
+
+    // Only a real change makes the chunk render again.
+    Uint8& slot = chunk->tiles[(y % TileChunk::kTiles) * TileChunk::kTiles + x % TileChunk::kTiles];
+    if (slot == tile) return;
+    slot           = tile;
+    chunk->version = nextVersion_++;
+}
+
+void Tilemap::Draw(FramePacket* packet, Camera& camera)
+{
+    SDL_FRect view = camera.GetVisibleRect();
+    int       x0   = SDL_max(FloorDiv((int)SDL_floorf(view.x), TileChunk::kSize), 0);
+    int       y0   = SDL_max(FloorDiv((int)SDL_floorf(view.y), TileChunk::kSize), 0);
+    int       x1   = SDL_min(FloorDiv((int)SDL_floorf(view.x + view.w), TileChunk::kSize),
+                             chunksX_ - 1);
+    int       y1   = SDL_min(FloorDiv((int)SDL_floorf(view.y + view.h), TileChunk::kSize),
+                             chunksY_ - 1);
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            float screenX, screenY;
+            camera.WorldToScreen((float)(x * TileChunk::kSize), (float)(y * TileChunk::kSize),
+                                 screenX, screenY);
+            packet->AddTileChunk(chunks_[y * chunksX_ + x], screenX, screenY);
+        }
+    }
+}
+
+TileChunk* Tilemap::GetChunk(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= chunksX_ || y >= chunksY_) return NULL;
+    return &chunks_[y * chunksX_ + x];
+}
@@ -0,0 +1,44 @@
+#ifndef TILEMAP_H_
+#define TILEMAP_H_
+
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "camera.h"
+#include "frame_packet.h"
+
+// A 2D map of tile indices stored chunk by chunk, so the tiles of a chunk
+// are contiguous and a chunk's version tells the render thread when its
+// prerendered texture is out of date. Only used by the game thread.
+class Tilemap
+{
+public:
+    Tilemap();
+
+    // A map of at least width by height tiles, all 0.
+    bool Create(int width, int height);
+    void Free();
+
+    int GetWidth() { return chunksX_ * TileChunk::kTiles; }
+    int GetHeight() { return chunksY_ * TileChunk::kTiles; }
+
+    // 0 outside the map.
+    Uint8 GetTile(int x, int y);
+    void  SetTile(int x, int y, Uint8 tile);
+
+    // Add the chunks the camera sees to the packet, placed on screen. The
+    // map's top left is at the world's origin.
+    void Draw(FramePacket* packet, Camera& camera);
+
+private:
+    TileChunk* GetChunk(int x, int y);
+
+    int                    chunksX_;
+    int                    chunksY_;
+    std::vector<TileChunk> chunks_;
+    // Never reused, not even by another map.
+    unsigned               nextVersion_;
+};
+
+#endif  // TILEMAP_H_
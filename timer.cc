@@ -1,5 +1,8 @@
 #include "timer.h"
 
+unsigned Timer::fixed_now_  = 0;
+unsigned Timer::fixed_step_ = 0;
+
 Timer::Timer() : start_ticks_(0), paused_ticks_(0), started_(true), paused_(false) {}
 
 void Timer::Start()
@@ -9,7 +12,7 @@ void Timer::Start()
     // Unpause the timer.
     paused_ = false;
     // Get the current clock time.
-    start_ticks_ = SDL_GetTicks();
+    start_ticks_ = Now();
     paused_ticks_ = 0;
 }
 
@@ -32,7 +35,7 @@ void Timer::Pause()
         // Pause the timer.
         paused_ = true;
         // Calculate the paused ticks.
-        paused_ticks_ = SDL_GetTicks() - start_ticks_;
+        paused_ticks_ = Now() - start_ticks_;
         start_ticks_ = 0;
     }
 }
@@ -45,7 +48,7 @@ void Timer::Unpause()
         // Unpaused the timer.
         paused_ = false;
         // Reset the starting ticks.
-        start_ticks_ = SDL_GetTicks() - paused_ticks_;
+        start_ticks_ = Now() - paused_ticks_;
         // Reset the paused ticks.
         paused_ticks_ = 0;
     }
@@ -58,7 +61,7 @@ unsigned Timer::GetTicks()
     if (started_)
     {
         // If the timer is running.
-        if (!paused_) time = SDL_GetTicks() - start_ticks_;
+        if (!paused_) time = Now() - start_ticks_;
         // Else the timer is paused.
         else          time = paused_ticks_;
     }
@@ -69,3 +72,13 @@ unsigned Timer::GetTicks()
 bool Timer::IsStarted() { return started_; }
 
 bool Timer::IsPaused() { return paused_; }
+
+void Timer::UseFixedClock(unsigned step)
+{
+    fixed_now_  = 0;
+    fixed_step_ = step;
+}
+
+void Timer::AdvanceFixedClock() { fixed_now_ += fixed_step_; }
+
+unsigned Timer::Now() { return fixed_step_ != 0 ? fixed_now_ : SDL_GetTicks(); }
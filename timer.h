@@ -22,7 +22,19 @@ public:
     bool IsStarted();
     bool IsPaused();
 
+    // Run every timer off a simulated clock that only moves by step
+    // milliseconds on AdvanceFixedClock(), for reproducible replays.
+    static void UseFixedClock(unsigned step);
+    static void AdvanceFixedClock();
+
+    // The current clock time, fixed or real.
+    static unsigned Now();
+
 private:
+    // The simulated clock, used while fixed_step_ isn't 0.
+    static unsigned fixed_now_;
+    static unsigned fixed_step_;
+
     // The clock time when the timer started.
     unsigned start_ticks_;
 
@@ -0,0 +1,40 @@
+#include "window_context.h"
+
+WindowContext::WindowContext() : window_(NULL), id_(0), width_(0), height_(0) {}
+
+WindowContext::~WindowContext() { Destroy(); }
+
+bool WindowContext::Create(const std::string& title, int x, int y, int width, int height)
+{
+    window_ = SDL_CreateWindow(title.c_str(), x, y, width, height,
+                               SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+    if (window_ == NULL) return false;
+
+    id_ = SDL_GetWindowID(window_);
+    UpdateSize();
+    return true;
+}
+
+bool WindowContext::Start(bool software, TextCache* texts, JobSystem* jobs)
+{
+    return renderThread_.Start(window_, software, texts, jobs);
+}
+
+void WindowContext::Stop()
+{
+    // The render thread destroys the renderer on its way out.
+    renderThread_.Stop();
+}
+
+void WindowContext::UpdateSize()
+{
+    SDL_GetWindowSize(window_, &width_, &height_);
+}
+
+void WindowContext::Destroy()
+{
+    Stop();
+    if (window_ != NULL) SDL_DestroyWindow(window_);
+    window_ = NULL;
+    id_     = 0;
+}
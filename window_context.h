@@ -0,0 +1,48 @@
+#ifndef WINDOW_CONTEXT_H_
+#define WINDOW_CONTEXT_H_
+
+#include <string>
+
+#include "SDL2/SDL.h"
+
+#include "job_system.h"
+#include "render_thread.h"
+#include "text_cache.h"
+
+// A resizable, high-DPI aware window with its own renderer and render loop.
+// The main thread builds a packet for every window each frame in the
+// window's logical pixels; each render thread presents at its own pace and
+// only the text cache is shared between them.
+class WindowContext
+{
+public:
+    WindowContext();
+    ~WindowContext();
+
+    bool Create(const std::string& title, int x, int y, int width, int height);
+    // Hand the renderer over to its own thread.
+    bool Start(bool software, TextCache* texts, JobSystem* jobs);
+    // Stop the render thread, the window itself stays until Destroy().
+    void Stop();
+    void Destroy();
+
+    // Read the window's size again, after it changed.
+    void UpdateSize();
+
+    SDL_Window*   GetWindow() { return window_; }
+    Uint32        GetId() { return id_; }
+    RenderThread& GetRenderThread() { return renderThread_; }
+
+    // The size in logical pixels, which may differ from the output's.
+    int GetWidth() { return width_; }
+    int GetHeight() { return height_; }
+
+private:
+    SDL_Window*  window_;
+    Uint32       id_;
+    int          width_;
+    int          height_;
+    RenderThread renderThread_;
+};
+
+#endif  // WINDOW_CONTEXT_H_